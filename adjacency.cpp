@@ -0,0 +1,145 @@
+#include "adjacency.h"
+
+#include <algorithm>
+
+// Faces or vertices per parallel slice
+static const GLuint ADJACENCY_GRAIN = 4096;
+
+/**
+ * forRange
+ * Runs body over [0, n), split across the pool when given.
+ */
+template <class F>
+static void forRange(ThreadPool *pool, GLuint n, F body)
+{
+    auto slice = [&](GLuint begin, GLuint end) {
+        for (GLuint i = begin; i < end; i++) body(i);
+    };
+    if (pool) pool->parallelFor(0, n, ADJACENCY_GRAIN, slice);
+    else      slice(0, n);
+}
+
+/**
+ * corners
+ * Copies the distinct vertices of face f into v.
+ * @return GLuint - their count, 0 if an index is out of range
+ */
+static GLuint corners(const Triangle &f, GLuint n, GLuint v[3])
+{
+    GLuint count = 0;
+
+    if (f.vertex1 >= n || f.vertex2 >= n || f.vertex3 >= n) return 0;
+    v[count++] = f.vertex1;
+    if (f.vertex2 != f.vertex1) v[count++] = f.vertex2;
+    if (f.vertex3 != f.vertex1 && f.vertex3 != f.vertex2) v[count++] = f.vertex3;
+    return count;
+}
+
+GLboolean Adjacency::update(GLuint mesh_version, GLuint n, const vector<Triangle> &faces,
+    ThreadPool *pool)
+{
+    if (builds && mesh_version == version && n == vertexCount()) return GL_FALSE;
+
+    build(n, faces, pool);
+    version = mesh_version;
+    return GL_TRUE;
+}
+
+void Adjacency::build(GLuint n, const vector<Triangle> &faces, ThreadPool *pool)
+{
+    GLuint nf = faces.size(), blocks = 1;
+
+    if (pool && nf > ADJACENCY_GRAIN)
+        blocks = std::min(std::max(pool->size(), 1u), (nf + ADJACENCY_GRAIN - 1) / ADJACENCY_GRAIN);
+    auto forBlocks = [&](const std::function<void(GLuint, GLuint, GLuint)> &body) {
+        auto run = [&](GLuint begin, GLuint end) {
+            for (GLuint b = begin; b < end; b++)
+                body(b, (GLuint)((unsigned long long)nf * b / blocks),
+                        (GLuint)((unsigned long long)nf * (b + 1) / blocks));
+        };
+        if (blocks > 1) pool->parallelFor(0, blocks, 1, run);
+        else            run(0, blocks);
+    };
+
+    // Pass 1: incidences per block and vertex
+    offsets.assign((size_t)blocks * n, 0);
+    forBlocks([&](GLuint b, GLuint begin, GLuint end) {
+        GLuint *count = &offsets[(size_t)b * n], v[3];
+        for (GLuint f = begin; f < end; f++)
+            for (GLuint k = corners(faces[f], n, v); k-- > 0; )
+                count[v[k]]++;
+    });
+
+    // Every block writes after the blocks before it
+    face_first.assign(n + 1, 0);
+    forRange(pool, n, [&](GLuint v) {
+        GLuint total = 0;
+        for (GLuint b = 0; b < blocks; b++) {
+            GLuint c = offsets[(size_t)b * n + v];
+            offsets[(size_t)b * n + v] = total;
+            total += c;
+        }
+        face_first[v + 1] = total;
+    });
+    for (GLuint v = 0; v < n; v++)
+        face_first[v + 1] += face_first[v];
+
+    // Pass 2: place the faces, ascending within every vertex
+    vertex_faces.resize(face_first[n]);
+    forBlocks([&](GLuint b, GLuint begin, GLuint end) {
+        GLuint *next = &offsets[(size_t)b * n], v[3];
+        for (GLuint f = begin; f < end; f++)
+            for (GLuint k = corners(faces[f], n, v); k-- > 0; )
+                vertex_faces[face_first[v[k]] + next[v[k]]++] = f;
+    });
+
+    // Neighbors: count the distinct ones, then write them
+    auto gather = [&](GLuint v, vector<GLuint> &out) {
+        GLuint c[3];
+        out.clear();
+        for (GLuint k = face_first[v]; k < face_first[v + 1]; k++)
+            for (GLuint i = corners(faces[vertex_faces[k]], n, c); i-- > 0; )
+                if (c[i] != v) out.push_back(c[i]);
+        std::sort(out.begin(), out.end());
+        out.erase(std::unique(out.begin(), out.end()), out.end());
+    };
+    ring_first.assign(n + 1, 0);
+    forRange(pool, n, [&](GLuint v) {
+        static thread_local vector<GLuint> scratch;
+        gather(v, scratch);
+        ring_first[v + 1] = scratch.size();
+    });
+    for (GLuint v = 0; v < n; v++)
+        ring_first[v + 1] += ring_first[v];
+
+    ring.resize(ring_first[n]);
+    forRange(pool, n, [&](GLuint v) {
+        static thread_local vector<GLuint> scratch;
+        gather(v, scratch);
+        std::copy(scratch.begin(), scratch.end(), ring.begin() + ring_first[v]);
+    });
+    builds++;
+}
+
+void Adjacency::vertexNormals(const vector<Vector3f> &verts, const vector<Triangle> &faces,
+    vector<Vector3f> &normals, ThreadPool *pool)
+{
+    GLuint n = vertexCount();
+
+    face_normals.resize(faces.size());
+    forRange(pool, faces.size(), [&](GLuint f) {
+        const Triangle &t = faces[f];
+        if (t.vertex1 >= n || t.vertex2 >= n || t.vertex3 >= n) return;
+        const Vector3f &a = verts[t.vertex1];
+        face_normals[f] = (verts[t.vertex2] - a).cross(verts[t.vertex3] - a);
+    });
+
+    normals.resize(n);
+    forRange(pool, n, [&](GLuint v) {
+        Vector3f sum(0.0f, 0.0f, 0.0f);
+        for (GLuint k = face_first[v]; k < face_first[v + 1]; k++)
+            sum += face_normals[vertex_faces[k]];
+        GLfloat len = sum.norm();
+        normals[v] = (len > 0.0f) ? Vector3f(sum / len) : sum;
+    });
+}
@@ -0,0 +1,77 @@
+/**
+ * adjacency.h
+ * This file contains the Adjacency class, compressed sparse row indices
+ * of the faces around every vertex and of the neighbors of every vertex.
+ * The faces of vertex v are vertex_faces[face_first[v] .. face_first[v+1])
+ * in ascending order, and its neighbors ring[ring_first[v] .. ring_first
+ * [v+1]) likewise, so per-vertex work such as normals or Laplacian rows
+ * gathers from its own slice instead of scattering from faces, and runs
+ * in parallel without atomics.
+ *
+ * Both indices are built by a two-pass counting sort: the faces are split
+ * into blocks that count their incidences per vertex, a scan over the
+ * blocks turns the counts into write offsets, and every block then places
+ * its faces. The result does not depend on the thread count.
+ */
+
+#ifndef _ADJACENCY_H_
+#define _ADJACENCY_H_
+
+#ifdef __APPLE__
+#include <OpenGL/gl.h>
+#else
+#include <GL/gl.h>
+#endif
+
+#include <vector>
+#include <Eigen/Core>
+#include "mesh.h"
+#include "threadpool.h"
+
+using std::vector;
+using Eigen::Vector3f;
+
+class Adjacency
+{
+public:
+    vector<GLuint> face_first, vertex_faces;    // faces around each vertex
+    vector<GLuint> ring_first, ring;             // neighbors of each vertex
+    GLuint version;                             // mesh version indexed
+    GLuint builds;                              // builds since construction
+
+    Adjacency(void) : version(0), builds(0) {}
+
+    /**
+     * update
+     * Rebuilds the indices for n vertices and faces unless they were
+     * already built for this mesh version.
+     * @return GLboolean - GL_TRUE if the indices were rebuilt
+     */
+    GLboolean update(GLuint mesh_version, GLuint n, const vector<Triangle> &faces,
+        ThreadPool *pool);
+
+    /**
+     * build
+     * Rebuilds both indices. Faces with an out of range index are left out.
+     */
+    void build(GLuint n, const vector<Triangle> &faces, ThreadPool *pool);
+
+    /**
+     * vertexNormals
+     * Writes the unit area-weighted normal of every vertex, gathered from
+     * its faces; vertices without faces get a zero normal.
+     */
+    void vertexNormals(const vector<Vector3f> &verts, const vector<Triangle> &faces,
+        vector<Vector3f> &normals, ThreadPool *pool);
+
+    GLuint vertexCount(void) const
+        { return face_first.empty() ? 0 : face_first.size() - 1; }
+    GLuint degree(GLuint v) const
+        { return ring_first[v + 1] - ring_first[v]; }
+
+private:
+    vector<GLuint> offsets;             // per block and vertex
+    vector<Vector3f> face_normals;
+};
+
+#endif
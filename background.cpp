@@ -0,0 +1,83 @@
+#include "background.h"
+
+Background::Background(void)
+    : latest(0), has_queued(GL_FALSE), running(GL_FALSE), stopping(GL_FALSE), done(0)
+{
+    thread = std::thread(&Background::run, this);
+}
+
+Background::~Background(void)
+{
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        stopping = GL_TRUE;
+        has_queued = GL_FALSE;
+        latest++;
+    }
+    wake.notify_one();
+    thread.join();
+}
+
+GLuint Background::submit(Job job)
+{
+    GLuint generation;
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        generation = ++latest;
+        queued = std::move(job);
+        has_queued = GL_TRUE;
+    }
+    wake.notify_one();
+    return generation;
+}
+
+void Background::cancel(void)
+{
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        has_queued = GL_FALSE;
+        latest++;
+    }
+    idle.notify_all();
+}
+
+GLboolean Background::busy(void)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    return has_queued || running;
+}
+
+void Background::wait(void)
+{
+    std::unique_lock<std::mutex> guard(lock);
+    idle.wait(guard, [this]() { return !has_queued && !running; });
+}
+
+GLuint Background::finished(void)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    return done;
+}
+
+void Background::run(void)
+{
+    std::unique_lock<std::mutex> guard(lock);
+
+    for (;;) {
+        wake.wait(guard, [this]() { return has_queued || stopping; });
+        if (stopping) return;
+
+        Job job = std::move(queued);
+        GLuint generation = latest;
+        has_queued = GL_FALSE;
+        running = GL_TRUE;
+
+        guard.unlock();
+        GLboolean complete = job(generation);
+        guard.lock();
+
+        running = GL_FALSE;
+        if (complete && generation == latest) done = generation;
+        if (!has_queued) idle.notify_all();
+    }
+}
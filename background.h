@@ -0,0 +1,81 @@
+/**
+ * background.h
+ * This file contains the Background class, a single worker thread for long
+ * jobs that must not block the window. Jobs carry a generation number and
+ * only the newest one matters: submitting a job supersedes the queued or
+ * running one, which sees that it was cancelled the next time it checks
+ * and returns early. finished reports the last job that ran to the end
+ * without being superseded, so its results can be picked up once the
+ * thread is idle.
+ */
+
+#ifndef _BACKGROUND_H_
+#define _BACKGROUND_H_
+
+#ifdef __APPLE__
+#include <OpenGL/gl.h>
+#else
+#include <GL/gl.h>
+#endif
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+class Background
+{
+public:
+    /**
+     * Job
+     * Runs with its generation, and returns GL_FALSE if it stopped early.
+     */
+    typedef std::function<GLboolean(GLuint)> Job;
+
+    Background(void);
+    ~Background(void);
+
+    /**
+     * submit
+     * Queues job in place of any queued one and cancels the running one.
+     * @return GLuint - the generation of job
+     */
+    GLuint submit(Job job);
+
+    /**
+     * cancel
+     * Cancels the queued and running jobs without replacing them.
+     */
+    void cancel(void);
+
+    GLboolean cancelled(GLuint generation) const
+        { return generation != latest; }
+
+    /**
+     * busy & wait
+     * Whether a job is queued or running, and blocking until none is.
+     */
+    GLboolean busy(void);
+    void wait(void);
+
+    /**
+     * finished
+     * @return GLuint - generation of the last job that completed while it
+     *                  was the newest, 0 if none has
+     */
+    GLuint finished(void);
+
+private:
+    std::thread thread;
+    std::mutex lock;
+    std::condition_variable wake, idle;
+    std::atomic<GLuint> latest;
+    Job queued;
+    GLboolean has_queued, running, stopping;
+    GLuint done;
+
+    void run(void);
+};
+
+#endif
@@ -0,0 +1,200 @@
+/**
+ * bvh.cpp
+ * Benchmarks the BVH on a wavy torus: serial and parallel builds, refit
+ * after a deformation, coherent and incoherent ray casts and closest-point
+ * queries, each checked against brute force on a sample. Run with "make
+ * bench"; an optional argument sets the ring count (default 1000, i.e.
+ * 500k vertices and 1M faces).
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include <random>
+#include "bvh.h"
+
+typedef std::chrono::steady_clock Clock;
+
+/**
+ * time
+ * Best of reps runs of f, in milliseconds.
+ */
+template <class F>
+static double time(GLuint reps, F f)
+{
+    double best = 1e30;
+    for (GLuint r = 0; r < reps; r++) {
+        Clock::time_point t0 = Clock::now();
+        f();
+        double ms = std::chrono::duration<double, std::milli>(Clock::now() - t0).count();
+        if (ms < best) best = ms;
+    }
+    return best;
+}
+
+/********* BRUTE FORCE REFERENCES *********/
+
+static GLfloat castAll(const vector<Vector3f> &v, const vector<Triangle> &faces,
+    const Vector3f &o, const Vector3f &d)
+{
+    GLfloat best = 1e30f;
+    for (GLuint f = 0; f < faces.size(); f++) {
+        Vector3f a = v[faces[f].vertex1];
+        Vector3f e1 = v[faces[f].vertex2] - a, e2 = v[faces[f].vertex3] - a;
+        Vector3f p = d.cross(e2), q = o - a, r = q.cross(e1);
+        GLfloat det = e1.dot(p);
+        if (det == 0.0f) continue;
+        GLfloat u = q.dot(p) / det, w = d.dot(r) / det, t = e2.dot(r) / det;
+        if (u >= 0.0f && w >= 0.0f && u + w <= 1.0f && t >= 0.0f && t < best) best = t;
+    }
+    return best;
+}
+
+static GLfloat segmentDistance(const Vector3f &p, const Vector3f &a, const Vector3f &b)
+{
+    Vector3f ab = b - a;
+    GLfloat t = std::min(std::max((p - a).dot(ab) / ab.squaredNorm(), 0.0f), 1.0f);
+    return (a + t * ab - p).norm();
+}
+
+static GLfloat nearestAll(const vector<Vector3f> &v, const vector<Triangle> &faces,
+    const Vector3f &p)
+{
+    GLfloat best = 1e30f;
+    for (GLuint f = 0; f < faces.size(); f++) {
+        Vector3f a = v[faces[f].vertex1], b = v[faces[f].vertex2], c = v[faces[f].vertex3];
+        Vector3f n = (b - a).cross(c - a).normalized();
+        Vector3f q = p - n.dot(p - a) * n;
+
+        // Inside when q is on the inner side of every edge
+        if ((b - a).cross(q - a).dot(n) >= 0.0f && (c - b).cross(q - b).dot(n) >= 0.0f &&
+            (a - c).cross(q - c).dot(n) >= 0.0f)
+            best = std::min(best, fabsf(n.dot(p - a)));
+        else
+            best = std::min(best, std::min(segmentDistance(p, a, b),
+                std::min(segmentDistance(p, b, c), segmentDistance(p, c, a))));
+    }
+    return best;
+}
+
+static void torus(GLuint rings, GLfloat wave, vector<Vector3f> &v, vector<Triangle> &faces)
+{
+    GLuint sides = rings / 2;
+    v.clear();
+    faces.clear();
+    for (GLuint i = 0; i < rings; i++) {
+        for (GLuint j = 0; j < sides; j++) {
+            GLfloat a = 2.0f * M_PI * i / rings, b = 2.0f * M_PI * j / sides;
+            GLfloat r = 80.0f + wave * sinf(9.0f * a) * cosf(5.0f * b);
+            v.push_back(Vector3f((300.0f + r * cosf(b)) * cosf(a),
+                                 (300.0f + r * cosf(b)) * sinf(a), r * sinf(b)));
+        }
+    }
+    for (GLuint i = 0; i < rings; i++) {
+        for (GLuint j = 0; j < sides; j++) {
+            GLuint p = i * sides + j, q = ((i + 1) % rings) * sides + j;
+            GLuint p1 = i * sides + (j + 1) % sides, q1 = ((i + 1) % rings) * sides + (j + 1) % sides;
+            faces.push_back(Triangle(p, q, q1));
+            faces.push_back(Triangle(p, q1, p1));
+        }
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    GLuint rings = (argc > 1) ? atoi(argv[1]) : 1000;
+    const GLuint reps = 3, samples = 64;
+    vector<Vector3f> verts, moved;
+    vector<Triangle> faces;
+    ThreadPool pool;
+    BVH serial, bvh;
+
+    torus(rings, 10.0f, verts, faces);
+    printf("%zu vertices, %zu faces, %u threads, best of %u runs\n\n",
+           verts.size(), faces.size(), pool.size(), reps);
+
+    double ts = time(reps, [&]() { serial.build(verts, faces, NULL); });
+    double tp = time(reps, [&]() { bvh.build(verts, faces, &pool); });
+    GLboolean same = serial.nodes.size() == bvh.nodes.size() &&
+        !memcmp(serial.nodes.data(), bvh.nodes.data(), bvh.nodes.size() * sizeof(BVHNode));
+    printf("build       serial %8.2f ms   pool %8.2f ms   %zu nodes of %zu bytes, same layout %s\n",
+           ts, tp, bvh.nodes.size(), sizeof(BVHNode), same ? "yes" : "NO");
+
+    // Coherent rays: a pinhole camera looking down at the torus
+    const GLuint side = 1024;
+    vector<Vector3f> origins, dirs;
+    for (GLuint y = 0; y < side; y++) {
+        for (GLuint x = 0; x < side; x++) {
+            origins.push_back(Vector3f(0.0f, -200.0f, 900.0f));
+            dirs.push_back(Vector3f((x - side / 2.0f) * 0.9f, (y - side / 2.0f) * 0.9f + 200.0f,
+                                    -900.0f).normalized());
+        }
+    }
+    // Incoherent rays: random points and directions inside the bounds;
+    // closest-point queries: vertices pushed up to 20 units off the surface
+    std::mt19937 rng(7);
+    std::uniform_real_distribution<GLfloat> unit(-1.0f, 1.0f);
+    vector<Vector3f> origins2, dirs2, points;
+    for (GLuint i = 0; i < side * side; i++) {
+        origins2.push_back(Vector3f(400.0f * unit(rng), 400.0f * unit(rng), 100.0f * unit(rng)));
+        dirs2.push_back(Vector3f(unit(rng), unit(rng), unit(rng)).normalized());
+        points.push_back(verts[rng() % verts.size()] +
+                         20.0f * Vector3f(unit(rng), unit(rng), unit(rng)));
+    }
+
+    auto cast = [&](const vector<Vector3f> &o, const vector<Vector3f> &d, const char *name) {
+        GLuint hits = 0;
+        double t = time(reps, [&]() {
+            hits = 0;
+            BVHHit hit;
+            for (GLuint i = 0; i < o.size(); i++)
+                hits += bvh.intersect(o[i], d[i], hit);
+        });
+        GLfloat err = 0.0f;
+        for (GLuint i = 0; i < samples; i++) {
+            GLuint k = (i * 7919u) % o.size();
+            BVHHit hit;
+            GLfloat ref = castAll(verts, faces, o[k], d[k]);
+            GLfloat got = bvh.intersect(o[k], d[k], hit) ? hit.t : 1e30f;
+            err = std::max(err, (ref == got) ? 0.0f : fabsf(ref - got));
+        }
+        printf("%-11s %8.2f ms   %6.2f Mrays/s   %u hits   max error vs brute force %.2g\n",
+               name, t, o.size() / t / 1e3, hits, err);
+    };
+    cast(origins, dirs, "primary");
+    cast(origins2, dirs2, "random");
+
+    auto nearest = [&](const char *name) {
+        double t = time(reps, [&]() {
+            BVHHit hit;
+            Vector3f q;
+            for (GLuint i = 0; i < points.size(); i++)
+                bvh.closest(points[i], hit, q);
+        });
+        GLfloat err = 0.0f;
+        for (GLuint i = 0; i < samples; i++) {
+            GLuint k = (i * 7919u) % points.size();
+            BVHHit hit;
+            Vector3f q;
+            bvh.closest(points[k], hit, q);
+            err = std::max(err, fabsf(hit.t - nearestAll(verts, faces, points[k])));
+        }
+        printf("%-11s %8.2f ms   %6.2f Mqueries/s            max error vs brute force %.2g\n",
+               name, t, points.size() / t / 1e3, err);
+    };
+    nearest("closest");
+
+    // Deform, then compare refitting with rebuilding
+    torus(rings, 25.0f, moved, faces);
+    BVH rebuilt;
+    double tr = time(reps, [&]() { rebuilt.build(moved, faces, &pool); });
+    verts = moved;
+    double tf = time(1, [&]() { bvh.refit(verts, faces, &pool); });
+    printf("\nrefit       %8.2f ms   rebuild %8.2f ms\n", tf, tr);
+    cast(origins, dirs, "refit rays");
+    std::swap(bvh, rebuilt);
+    cast(origins, dirs, "rebuilt");
+    return 0;
+}
@@ -0,0 +1,163 @@
+/**
+ * layout.cpp
+ * Benchmarks the bulk geometry kernels on the array-of-structs layout used
+ * by mesh_verts (vector<Vector3f>) against the structure-of-arrays layout
+ * of VertexArray. Run with "make bench"; an optional argument sets the
+ * grid resolution (default 1024, i.e. 1M vertices and 2M faces).
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cmath>
+#include "vertexarray.h"
+
+typedef std::chrono::steady_clock Clock;
+
+/**
+ * time
+ * Best of reps runs of f, in milliseconds.
+ */
+template <class F>
+static double time(GLuint reps, F f)
+{
+    double best = 1e30;
+    for (GLuint r = 0; r < reps; r++) {
+        Clock::time_point t0 = Clock::now();
+        f();
+        double ms = std::chrono::duration<double, std::milli>(Clock::now() - t0).count();
+        if (ms < best) best = ms;
+    }
+    return best;
+}
+
+/********* ARRAY-OF-STRUCTS REFERENCE KERNELS *********/
+
+static void transformAoS(vector<Vector3f> &v, const Matrix4f &m)
+{
+    Eigen::Matrix3f a = m.topLeftCorner<3, 3>();
+    Vector3f t = m.topRightCorner<3, 1>();
+    for (GLuint i = 0; i < v.size(); i++)
+        v[i] = a * v[i] + t;
+}
+
+static void boundsAoS(const vector<Vector3f> &v, Vector3f &lo, Vector3f &hi)
+{
+    lo = Vector3f::Constant(1e30f);
+    hi = Vector3f::Constant(-1e30f);
+    for (GLuint i = 0; i < v.size(); i++) {
+        lo = lo.cwiseMin(v[i]);
+        hi = hi.cwiseMax(v[i]);
+    }
+}
+
+static void normalsAoS(const vector<Vector3f> &v, const vector<Triangle> &faces,
+    vector<Vector3f> &out)
+{
+    out.assign(v.size(), Vector3f::Zero());
+    for (GLuint f = 0; f < faces.size(); f++) {
+        const Triangle &t = faces[f];
+        Vector3f c = (v[t.vertex2] - v[t.vertex1]).cross(v[t.vertex3] - v[t.vertex1]);
+        out[t.vertex1] += c;
+        out[t.vertex2] += c;
+        out[t.vertex3] += c;
+    }
+    for (GLuint i = 0; i < out.size(); i++)
+        out[i] /= sqrtf(std::max(out[i].squaredNorm(), 1e-30f));
+}
+
+static void smoothAoS(vector<Vector3f> &v, const vector<Triangle> &faces,
+    GLfloat lambda, GLuint iterations)
+{
+    vector<GLfloat> w(v.size(), 0.0f);
+    vector<Vector3f> sum;
+
+    for (GLuint f = 0; f < faces.size(); f++) {
+        w[faces[f].vertex1] += 2.0f;
+        w[faces[f].vertex2] += 2.0f;
+        w[faces[f].vertex3] += 2.0f;
+    }
+    for (GLuint it = 0; it < iterations; it++) {
+        sum.assign(v.size(), Vector3f::Zero());
+        for (GLuint f = 0; f < faces.size(); f++) {
+            GLuint t[3] = { faces[f].vertex1, faces[f].vertex2, faces[f].vertex3 };
+            for (GLuint e = 0; e < 3; e++) {
+                GLuint a = t[e], b = t[(e + 1) % 3];
+                sum[a] += v[b];
+                sum[b] += v[a];
+            }
+        }
+        for (GLuint i = 0; i < v.size(); i++)
+            if (w[i] > 0.0f)
+                v[i] += lambda * (sum[i] / w[i] - v[i]);
+    }
+}
+
+/********* DRIVER *********/
+
+static GLfloat maxDifference(const vector<Vector3f> &a, const VertexArray &b)
+{
+    GLfloat d = 0.0f;
+    for (GLuint i = 0; i < a.size(); i++)
+        d = std::max(d, (a[i] - b.get(i)).cwiseAbs().maxCoeff());
+    return d;
+}
+
+static void report(const char *name, double aos, double soa, GLfloat diff)
+{
+    printf("%-10s  AoS %8.2f ms   SoA %8.2f ms   speedup %5.2fx   max diff %.2g\n",
+           name, aos, soa, aos / soa, diff);
+}
+
+int main(int argc, char *argv[])
+{
+    GLuint side = (argc > 1) ? atoi(argv[1]) : 1024, i, j;
+    const GLuint reps = 5;
+    vector<Vector3f> verts;
+    vector<Triangle> faces;
+
+    // Wavy height field grid
+    for (j = 0; j < side; j++)
+        for (i = 0; i < side; i++)
+            verts.push_back(Vector3f(i, j, 8.0f * sinf(i * 0.05f) * cosf(j * 0.07f)));
+    for (j = 0; j + 1 < side; j++) {
+        for (i = 0; i + 1 < side; i++) {
+            GLuint p = j * side + i;
+            faces.push_back(Triangle(p, p + 1, p + side + 1));
+            faces.push_back(Triangle(p, p + side + 1, p + side));
+        }
+    }
+    printf("%zu vertices, %zu faces, best of %u runs\n\n", verts.size(), faces.size(), reps);
+
+    Matrix4f m = Matrix4f::Identity();
+    m.topLeftCorner<3, 3>() = Eigen::AngleAxisf(0.3f, Vector3f(1, 2, 3).normalized()).toRotationMatrix();
+    m.topRightCorner<3, 1>() = Vector3f(5, -2, 1);
+
+    vector<Vector3f> aos = verts, aos_out;
+    VertexArray soa(verts), soa_out;
+    double ta, ts;
+
+    ta = time(reps, [&]() { transformAoS(aos, m); });
+    ts = time(reps, [&]() { soa.transform(m); });
+    report("transform", ta, ts, maxDifference(aos, soa));
+
+    Vector3f lo_a, hi_a, lo_s, hi_s;
+    ta = time(reps, [&]() { boundsAoS(aos, lo_a, hi_a); });
+    ts = time(reps, [&]() { soa.bounds(lo_s, hi_s); });
+    report("bounds", ta, ts, std::max((lo_a - lo_s).cwiseAbs().maxCoeff(),
+                                      (hi_a - hi_s).cwiseAbs().maxCoeff()));
+
+    ta = time(reps, [&]() { normalsAoS(aos, faces, aos_out); });
+    ts = time(reps, [&]() { soa.normals(faces, soa_out); });
+    report("normals", ta, ts, maxDifference(aos_out, soa_out));
+
+    ta = time(1, [&]() { smoothAoS(aos, faces, 0.5f, 10); });
+    ts = time(1, [&]() { soa.smooth(faces, 0.5f, 10); });
+    report("smooth x10", ta, ts, maxDifference(aos, soa));
+
+    vector<Vector3f> back;
+    ta = time(reps, [&]() { soa.copyTo(back); });
+    ts = time(reps, [&]() { soa_out.assign(back); });
+    printf("\nadapters    to AoS %.2f ms   from AoS %.2f ms\n", ta, ts);
+    return 0;
+}
@@ -0,0 +1,622 @@
+#include "bvh.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define BVH_SSE
+#endif
+
+// Faces per parallel slice, and subtrees small enough to build in one task
+static const GLuint BVH_GRAIN = 4096;
+static const GLuint BVH_TASK_SIZE = 1 << 14;
+
+// Below this depth splits halve the largest child instead of using SAH,
+// which bounds the depth and with it the traversal stack
+static const GLuint BVH_MAX_DEPTH = 48;
+static const GLuint BVH_STACK = 256;
+
+/**
+ * forRange
+ * Runs body over [0, n), split across the pool when given.
+ */
+template <class F>
+static void forRange(ThreadPool *pool, GLuint n, F body)
+{
+    auto slice = [&](GLuint begin, GLuint end) {
+        for (GLuint i = begin; i < end; i++) body(i);
+    };
+    if (pool) pool->parallelFor(0, n, BVH_GRAIN, slice);
+    else      slice(0, n);
+}
+
+/**
+ * Box struct
+ * Axis-aligned box; the default box is empty and grows to fit.
+ */
+struct Box {
+    Vector3f lo, hi;
+
+    Box(void) : lo(Vector3f::Constant(FLT_MAX)), hi(Vector3f::Constant(-FLT_MAX)) {}
+
+    void grow(const Vector3f &p) { lo = lo.cwiseMin(p); hi = hi.cwiseMax(p); }
+    void grow(const Box &b)      { lo = lo.cwiseMin(b.lo); hi = hi.cwiseMax(b.hi); }
+
+    GLfloat area(void) const
+    {
+        if (lo.x() > hi.x()) return 0.0f;
+        Vector3f d = hi - lo;
+        return d.x() * d.y() + d.y() * d.z() + d.z() * d.x();
+    }
+};
+
+/**
+ * Range struct
+ * Faces order[begin .. end) with the box around them and around their
+ * centroids.
+ */
+struct Range {
+    GLuint begin, end;
+    Box box, centroids;
+
+    GLuint count(void) const { return end - begin; }
+};
+
+/**
+ * Build struct
+ * Per-face boxes and centroids shared by every subtree of one build.
+ */
+struct Build {
+    vector<Box> boxes;
+    vector<Vector3f> centers;
+    vector<GLuint> order;
+};
+
+/**
+ * Deferred struct
+ * Subtree left for a task: its range and the slot that will point to it.
+ */
+struct Deferred {
+    Range range;
+    GLuint node, slot, depth;
+    vector<BVHNode> nodes;
+};
+
+static void setSlot(BVHNode &node, GLuint slot, const Box &box)
+{
+    for (GLuint a = 0; a < 3; a++) {
+        node.bounds[a][slot]     = box.lo[a];
+        node.bounds[a + 3][slot] = box.hi[a];
+    }
+}
+
+static Box slotBox(const BVHNode &node, GLuint slot)
+{
+    Box box;
+    for (GLuint a = 0; a < 3; a++) {
+        box.lo[a] = node.bounds[a][slot];
+        box.hi[a] = node.bounds[a + 3][slot];
+    }
+    return box;
+}
+
+static void finishRange(const Build &build, Range &r)
+{
+    r.box = Box();
+    r.centroids = Box();
+    for (GLuint i = r.begin; i < r.end; i++) {
+        r.box.grow(build.boxes[build.order[i]]);
+        r.centroids.grow(build.centers[build.order[i]]);
+    }
+}
+
+/**
+ * split
+ * Splits r at the cheapest of the BVH_BINS - 1 planes per axis by the
+ * surface area heuristic, or at the median centroid of its longest axis
+ * when median is set or every centroid coincides.
+ */
+static void split(Build &build, const Range &r, Range &left, Range &right,
+    GLboolean median)
+{
+    struct Bin {
+        Box box;
+        GLuint count;
+    };
+    const Vector3f extent = r.centroids.hi - r.centroids.lo;
+    GLuint *order = build.order.data();
+    GLfloat best = FLT_MAX;
+    GLint best_axis = -1;
+    GLuint best_bin = 0;
+
+    for (GLuint axis = 0; axis < 3 && !median; axis++) {
+        if (!(extent[axis] > 0.0f)) continue;
+
+        Bin bins[BVH_BINS];
+        GLfloat scale = BVH_BINS / extent[axis] * (1.0f - 1e-6f);
+        for (GLuint b = 0; b < BVH_BINS; b++) bins[b].count = 0;
+        for (GLuint i = r.begin; i < r.end; i++) {
+            GLuint f = order[i];
+            GLuint b = std::min(BVH_BINS - 1,
+                (GLuint)((build.centers[f][axis] - r.centroids.lo[axis]) * scale));
+            bins[b].box.grow(build.boxes[f]);
+            bins[b].count++;
+        }
+
+        // Area and count right of every plane, then sweep from the left
+        GLfloat right_area[BVH_BINS];
+        GLuint right_count[BVH_BINS];
+        Box sweep;
+        GLuint count = 0;
+        for (GLuint b = BVH_BINS - 1; b > 0; b--) {
+            sweep.grow(bins[b].box);
+            count += bins[b].count;
+            right_area[b] = sweep.area();
+            right_count[b] = count;
+        }
+        sweep = Box();
+        count = 0;
+        for (GLuint b = 0; b + 1 < BVH_BINS; b++) {
+            sweep.grow(bins[b].box);
+            count += bins[b].count;
+            if (count == 0 || right_count[b + 1] == 0) continue;
+            GLfloat cost = sweep.area() * count + right_area[b + 1] * right_count[b + 1];
+            if (cost < best) {
+                best = cost;
+                best_axis = axis;
+                best_bin = b;
+            }
+        }
+    }
+
+    GLuint mid;
+    if (best_axis >= 0) {
+        GLfloat lo = r.centroids.lo[best_axis];
+        GLfloat scale = BVH_BINS / extent[best_axis] * (1.0f - 1e-6f);
+        mid = std::partition(order + r.begin, order + r.end, [&](GLuint f) {
+            return std::min(BVH_BINS - 1,
+                (GLuint)((build.centers[f][best_axis] - lo) * scale)) <= best_bin;
+        }) - order;
+    } else {
+        GLuint axis = 0;
+        if (extent.y() > extent[axis]) axis = 1;
+        if (extent.z() > extent[axis]) axis = 2;
+        mid = r.begin + r.count() / 2;
+        std::nth_element(order + r.begin, order + mid, order + r.end,
+            [&](GLuint a, GLuint b) {
+                return build.centers[a][axis] < build.centers[b][axis] ||
+                       (build.centers[a][axis] == build.centers[b][axis] && a < b);
+            });
+    }
+
+    left.begin = r.begin;
+    left.end = mid;
+    right.begin = mid;
+    right.end = r.end;
+    finishRange(build, left);
+    finishRange(build, right);
+}
+
+/**
+ * buildNode
+ * Appends the node for r to nodes and builds its subtrees, splitting the
+ * child with the largest surface (or the most faces, below
+ * BVH_MAX_DEPTH) until there are four. Subtrees of at most BVH_TASK_SIZE
+ * faces go to deferred when it is given, and are built here otherwise.
+ * @return GLint - index of the node
+ */
+static GLint buildNode(Build &build, const Range &r, vector<BVHNode> &nodes,
+    GLuint depth, vector<Deferred> *deferred)
+{
+    GLint index = nodes.size();
+    nodes.push_back(BVHNode());
+
+    Range kids[4];
+    GLuint n = 1;
+    kids[0] = r;
+    while (n < 4) {
+        GLint pick = -1;
+        GLfloat most = 0.0f;
+        for (GLuint k = 0; k < n; k++) {
+            if (kids[k].count() <= BVH_LEAF_SIZE) continue;
+            GLfloat size = (depth < BVH_MAX_DEPTH) ? kids[k].box.area() : kids[k].count();
+            if (pick < 0 || size > most) {
+                pick = k;
+                most = size;
+            }
+        }
+        if (pick < 0) break;
+
+        Range a, b;
+        split(build, kids[pick], a, b, depth >= BVH_MAX_DEPTH);
+        kids[pick] = a;
+        kids[n++] = b;
+    }
+
+    for (GLuint s = 0; s < 4; s++) {
+        BVHNode &node = nodes[index];
+        node.child[s] = -1;
+        node.count[s] = 0;
+        setSlot(node, s, s < n ? kids[s].box : Box());
+        if (s >= n) continue;
+
+        if (kids[s].count() <= BVH_LEAF_SIZE) {
+            node.child[s] = kids[s].begin;
+            node.count[s] = kids[s].count();
+        } else if (deferred && kids[s].count() <= BVH_TASK_SIZE) {
+            Deferred task;
+            task.range = kids[s];
+            task.node = index;
+            task.slot = s;
+            task.depth = depth + 1;
+            deferred->push_back(task);
+        } else {
+            GLint child = buildNode(build, kids[s], nodes, depth + 1, deferred);
+            nodes[index].child[s] = child;
+        }
+    }
+    return index;
+}
+
+/**
+ * pack
+ * Writes the leaf copy of face f.
+ */
+static void pack(const vector<Vector3f> &verts, const Triangle &t, GLuint f,
+    BVHTriangle &out)
+{
+    out.v0 = verts[t.vertex1];
+    out.e1 = verts[t.vertex2] - out.v0;
+    out.e2 = verts[t.vertex3] - out.v0;
+    out.face = f;
+}
+
+void BVH::build(const vector<Vector3f> &verts, const vector<Triangle> &faces,
+    ThreadPool *pool)
+{
+    GLuint nv = verts.size(), nf = faces.size();
+    Build b;
+
+    nodes.clear();
+    triangles.clear();
+
+    b.boxes.resize(nf);
+    b.centers.resize(nf);
+    forRange(pool, nf, [&](GLuint f) {
+        const Triangle &t = faces[f];
+        if (t.vertex1 >= nv || t.vertex2 >= nv || t.vertex3 >= nv) return;
+        Box box;
+        box.grow(verts[t.vertex1]);
+        box.grow(verts[t.vertex2]);
+        box.grow(verts[t.vertex3]);
+        b.boxes[f] = box;
+        b.centers[f] = 0.5f * (box.lo + box.hi);
+    });
+    for (GLuint f = 0; f < nf; f++) {
+        const Triangle &t = faces[f];
+        if (t.vertex1 < nv && t.vertex2 < nv && t.vertex3 < nv)
+            b.order.push_back(f);
+    }
+    if (b.order.empty()) return;
+
+    Range root;
+    root.begin = 0;
+    root.end = b.order.size();
+    finishRange(b, root);
+
+    // Top levels here, the subtrees below them as tasks; serial builds
+    // take the same route so the layout is the same either way
+    vector<BVHNode> top;
+    vector<Deferred> deferred;
+    buildNode(b, root, top, 0, &deferred);
+
+    TaskGroup group;
+    for (GLuint k = 0; k < deferred.size(); k++) {
+        Deferred *task = &deferred[k];
+        auto run = [&b, task]() {
+            buildNode(b, task->range, task->nodes, task->depth, NULL);
+        };
+        if (pool) pool->submit(group, run);
+        else      run();
+    }
+    if (pool) pool->wait(group);
+
+    // Append the subtrees in order and point their slots at them
+    nodes.assign(top.begin(), top.end());
+    for (GLuint k = 0; k < deferred.size(); k++) {
+        Deferred &task = deferred[k];
+        GLint offset = nodes.size();
+        for (GLuint i = 0; i < task.nodes.size(); i++) {
+            BVHNode node = task.nodes[i];
+            for (GLuint s = 0; s < 4; s++)
+                if (node.count[s] == 0 && node.child[s] >= 0) node.child[s] += offset;
+            nodes.push_back(node);
+        }
+        nodes[task.node].child[task.slot] = offset;
+    }
+
+    triangles.resize(b.order.size());
+    forRange(pool, b.order.size(), [&](GLuint i) {
+        pack(verts, faces[b.order[i]], b.order[i], triangles[i]);
+    });
+}
+
+void BVH::refit(const vector<Vector3f> &verts, const vector<Triangle> &faces,
+    ThreadPool *pool)
+{
+    GLuint nv = verts.size();
+
+    forRange(pool, triangles.size(), [&](GLuint i) {
+        GLuint f = triangles[i].face;
+        if (f >= faces.size()) return;
+        const Triangle &t = faces[f];
+        if (t.vertex1 < nv && t.vertex2 < nv && t.vertex3 < nv)
+            pack(verts, t, f, triangles[i]);
+    });
+
+    // Leaf slots in parallel; inner slots after their children, which
+    // always come later in the array
+    forRange(pool, nodes.size(), [&](GLuint i) {
+        BVHNode &node = nodes[i];
+        for (GLuint s = 0; s < 4; s++) {
+            if (node.count[s] == 0) continue;
+            Box box;
+            for (GLuint k = node.child[s]; k < node.child[s] + node.count[s]; k++) {
+                const BVHTriangle &t = triangles[k];
+                box.grow(t.v0);
+                box.grow(Vector3f(t.v0 + t.e1));
+                box.grow(Vector3f(t.v0 + t.e2));
+            }
+            setSlot(node, s, box);
+        }
+    });
+    for (GLuint i = nodes.size(); i-- > 0; ) {
+        BVHNode &node = nodes[i];
+        for (GLuint s = 0; s < 4; s++) {
+            if (node.count[s] != 0 || node.child[s] < 0) continue;
+            const BVHNode &child = nodes[node.child[s]];
+            Box box;
+            for (GLuint k = 0; k < 4; k++) box.grow(slotBox(child, k));
+            setSlot(node, s, box);
+        }
+    }
+}
+
+/**
+ * Entry struct
+ * Traversal stack entry: a node and the distance at which it was entered.
+ */
+struct Entry {
+    GLint node;
+    GLfloat t;
+};
+
+/**
+ * pushSorted
+ * Pushes the n entries so that the nearest is popped first.
+ */
+static void pushSorted(Entry *stack, GLuint &top, Entry *kids, GLuint n)
+{
+    for (GLuint i = 1; i < n; i++)
+        for (GLuint j = i; j > 0 && kids[j].t > kids[j - 1].t; j--)
+            std::swap(kids[j], kids[j - 1]);
+    for (GLuint i = 0; i < n; i++)
+        stack[top++] = kids[i];
+}
+
+GLboolean BVH::intersect(const Vector3f &origin, const Vector3f &dir, BVHHit &hit,
+    GLfloat tmax) const
+{
+    if (nodes.empty()) return GL_FALSE;
+
+    const Vector3f inv(1.0f / dir.x(), 1.0f / dir.y(), 1.0f / dir.z());
+    GLuint near[3], far[3];
+    for (GLuint a = 0; a < 3; a++) {
+        near[a] = std::signbit(dir[a]) ? a + 3 : a;
+        far[a]  = std::signbit(dir[a]) ? a : a + 3;
+    }
+    GLfloat best = tmax;
+    GLboolean found = GL_FALSE;
+
+#ifdef BVH_SSE
+    const __m128 ox = _mm_set1_ps(origin.x()), oy = _mm_set1_ps(origin.y()),
+                 oz = _mm_set1_ps(origin.z());
+    const __m128 ix = _mm_set1_ps(inv.x()), iy = _mm_set1_ps(inv.y()),
+                 iz = _mm_set1_ps(inv.z());
+#endif
+
+    Entry stack[BVH_STACK], kids[4];
+    GLuint top = 0;
+    stack[top].node = 0;
+    stack[top++].t = 0.0f;
+    while (top) {
+        Entry e = stack[--top];
+        if (e.t >= best) continue;
+        const BVHNode &node = nodes[e.node];
+
+        // Entry distance of every slot, and the slots entered before best
+        GLfloat enter[4];
+        GLuint mask = 0;
+#ifdef BVH_SSE
+        // NaN from 0 * inf falls through max/min to the other operand
+        __m128 t0 = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(node.bounds[near[0]]), ox), ix);
+        __m128 t1 = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(node.bounds[far[0]]), ox), ix);
+        __m128 lo = _mm_max_ps(t0, _mm_setzero_ps());
+        __m128 hi = _mm_min_ps(t1, _mm_set1_ps(best));
+        t0 = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(node.bounds[near[1]]), oy), iy);
+        t1 = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(node.bounds[far[1]]), oy), iy);
+        lo = _mm_max_ps(t0, lo);
+        hi = _mm_min_ps(t1, hi);
+        t0 = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(node.bounds[near[2]]), oz), iz);
+        t1 = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(node.bounds[far[2]]), oz), iz);
+        lo = _mm_max_ps(t0, lo);
+        hi = _mm_min_ps(t1, hi);
+        mask = _mm_movemask_ps(_mm_cmple_ps(lo, hi));
+        _mm_storeu_ps(enter, lo);
+#else
+        for (GLuint s = 0; s < 4; s++) {
+            GLfloat lo = 0.0f, hi = best;
+            for (GLuint a = 0; a < 3; a++) {
+                GLfloat t0 = (node.bounds[near[a]][s] - origin[a]) * inv[a];
+                GLfloat t1 = (node.bounds[far[a]][s] - origin[a]) * inv[a];
+                lo = (t0 > lo) ? t0 : lo;
+                hi = (t1 < hi) ? t1 : hi;
+            }
+            enter[s] = lo;
+            if (lo <= hi) mask |= 1u << s;
+        }
+#endif
+
+        GLuint n = 0;
+        for (GLuint s = 0; s < 4; s++) {
+            if (!(mask & (1u << s)) || node.child[s] < 0) continue;
+            if (node.count[s] == 0) {
+                kids[n].node = node.child[s];
+                kids[n++].t = enter[s];
+                continue;
+            }
+
+            // Moller-Trumbore against every face of the leaf
+            for (GLuint k = node.child[s]; k < node.child[s] + node.count[s]; k++) {
+                const BVHTriangle &tri = triangles[k];
+                Vector3f p = dir.cross(tri.e2);
+                GLfloat det = tri.e1.dot(p);
+                if (det == 0.0f) continue;
+                GLfloat inv_det = 1.0f / det;
+                Vector3f q = origin - tri.v0;
+                GLfloat u = q.dot(p) * inv_det;
+                if (u < 0.0f || u > 1.0f) continue;
+                Vector3f r = q.cross(tri.e1);
+                GLfloat v = dir.dot(r) * inv_det;
+                if (v < 0.0f || u + v > 1.0f) continue;
+                GLfloat t = tri.e2.dot(r) * inv_det;
+                if (t < 0.0f || t >= best) continue;
+
+                best = t;
+                found = GL_TRUE;
+                hit.face = tri.face;
+                hit.t = t;
+                hit.u = u;
+                hit.v = v;
+            }
+        }
+        pushSorted(stack, top, kids, n);
+    }
+    return found;
+}
+
+/**
+ * closestOnTriangle
+ * Point of the triangle nearest to p, as v0 + u e1 + v e2 (Ericson,
+ * Real-Time Collision Detection 5.1.5).
+ */
+static void closestOnTriangle(const Vector3f &p, const BVHTriangle &tri,
+    GLfloat &u, GLfloat &v)
+{
+    const Vector3f &ab = tri.e1, &ac = tri.e2;
+    Vector3f ap = p - tri.v0;
+    GLfloat d1 = ab.dot(ap), d2 = ac.dot(ap);
+    if (d1 <= 0.0f && d2 <= 0.0f) { u = 0.0f; v = 0.0f; return; }
+
+    Vector3f bp = ap - ab;
+    GLfloat d3 = ab.dot(bp), d4 = ac.dot(bp);
+    if (d3 >= 0.0f && d4 <= d3) { u = 1.0f; v = 0.0f; return; }
+
+    GLfloat vc = d1 * d4 - d3 * d2;
+    if (vc <= 0.0f && d1 >= 0.0f && d3 <= 0.0f) { u = d1 / (d1 - d3); v = 0.0f; return; }
+
+    Vector3f cp = ap - ac;
+    GLfloat d5 = ab.dot(cp), d6 = ac.dot(cp);
+    if (d6 >= 0.0f && d5 <= d6) { u = 0.0f; v = 1.0f; return; }
+
+    GLfloat vb = d5 * d2 - d1 * d6;
+    if (vb <= 0.0f && d2 >= 0.0f && d6 <= 0.0f) { u = 0.0f; v = d2 / (d2 - d6); return; }
+
+    GLfloat va = d3 * d6 - d5 * d4;
+    if (va <= 0.0f && d4 - d3 >= 0.0f && d5 - d6 >= 0.0f) {
+        v = (d4 - d3) / ((d4 - d3) + (d5 - d6));
+        u = 1.0f - v;
+        return;
+    }
+
+    GLfloat denom = 1.0f / (va + vb + vc);
+    u = vb * denom;
+    v = vc * denom;
+}
+
+GLboolean BVH::closest(const Vector3f &p, BVHHit &hit, Vector3f &point,
+    GLfloat max_dist) const
+{
+    if (nodes.empty()) return GL_FALSE;
+
+    GLfloat best = (max_dist < 1e18f) ? max_dist * max_dist : FLT_MAX;
+    GLboolean found = GL_FALSE;
+
+#ifdef BVH_SSE
+    const __m128 px = _mm_set1_ps(p.x()), py = _mm_set1_ps(p.y()), pz = _mm_set1_ps(p.z());
+    const __m128 zero = _mm_setzero_ps();
+#endif
+
+    Entry stack[BVH_STACK], kids[4];
+    GLuint top = 0;
+    stack[top].node = 0;
+    stack[top++].t = 0.0f;
+    while (top) {
+        Entry e = stack[--top];
+        if (e.t > best) continue;
+        const BVHNode &node = nodes[e.node];
+
+        // Squared distance from p to every slot
+        GLfloat dist[4];
+#ifdef BVH_SSE
+        __m128 dx = _mm_max_ps(_mm_max_ps(_mm_sub_ps(_mm_load_ps(node.bounds[0]), px),
+                                          _mm_sub_ps(px, _mm_load_ps(node.bounds[3]))), zero);
+        __m128 dy = _mm_max_ps(_mm_max_ps(_mm_sub_ps(_mm_load_ps(node.bounds[1]), py),
+                                          _mm_sub_ps(py, _mm_load_ps(node.bounds[4]))), zero);
+        __m128 dz = _mm_max_ps(_mm_max_ps(_mm_sub_ps(_mm_load_ps(node.bounds[2]), pz),
+                                          _mm_sub_ps(pz, _mm_load_ps(node.bounds[5]))), zero);
+        _mm_storeu_ps(dist, _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)),
+                                       _mm_mul_ps(dz, dz)));
+#else
+        for (GLuint s = 0; s < 4; s++) {
+            dist[s] = 0.0f;
+            for (GLuint a = 0; a < 3; a++) {
+                GLfloat d = std::max(std::max(node.bounds[a][s] - p[a],
+                                              p[a] - node.bounds[a + 3][s]), 0.0f);
+                dist[s] += d * d;
+            }
+        }
+#endif
+
+        GLuint n = 0;
+        for (GLuint s = 0; s < 4; s++) {
+            if (node.child[s] < 0 || dist[s] > best) continue;
+            if (node.count[s] == 0) {
+                kids[n].node = node.child[s];
+                kids[n++].t = dist[s];
+                continue;
+            }
+
+            for (GLuint k = node.child[s]; k < node.child[s] + node.count[s]; k++) {
+                const BVHTriangle &tri = triangles[k];
+                GLfloat u, v;
+                closestOnTriangle(p, tri, u, v);
+                Vector3f q = tri.v0 + u * tri.e1 + v * tri.e2;
+                GLfloat d = (q - p).squaredNorm();
+                if (d > best || (found && d == best)) continue;
+
+                best = d;
+                found = GL_TRUE;
+                point = q;
+                hit.face = tri.face;
+                hit.u = u;
+                hit.v = v;
+            }
+        }
+        pushSorted(stack, top, kids, n);
+    }
+    if (found) hit.t = sqrtf(best);
+    return found;
+}
@@ -0,0 +1,114 @@
+/**
+ * bvh.h
+ * This file contains the BVH class, a bounding volume hierarchy over the
+ * faces of a triangle mesh for ray casts and closest-point queries.
+ *
+ * The tree is built top-down with binned surface area heuristic splits
+ * and stored four-wide: every node holds the boxes of its four children
+ * as coordinate arrays, so one SSE pass tests a ray or point against all
+ * four. Nodes are 128 bytes on 64-byte boundaries, and leaves point into
+ * a copy of their triangles stored in leaf order as a corner and two
+ * edges. Large subtrees are built in parallel into private node arrays
+ * that are appended in a fixed order, so the layout does not depend on
+ * the thread count. After the vertices move, refit recomputes the boxes
+ * without changing the tree.
+ */
+
+#ifndef _BVH_H_
+#define _BVH_H_
+
+#ifdef __APPLE__
+#include <OpenGL/gl.h>
+#else
+#include <GL/gl.h>
+#endif
+
+#include <vector>
+#include <Eigen/Core>
+#include "mesh.h"
+#include "threadpool.h"
+
+using std::vector;
+using Eigen::Vector3f;
+
+// Triangles per leaf, and SAH bins per axis
+const GLuint BVH_LEAF_SIZE = 4;
+const GLuint BVH_BINS = 16;
+
+/**
+ * BVHNode struct
+ * Four child slots. Slot k has box bounds[0..2][k] to bounds[3..5][k]
+ * (lower then upper x, y, z). An inner slot has count 0 and its node in
+ * child, a leaf slot count triangles from child, and an empty slot an
+ * inverted box and child -1.
+ */
+struct alignas(64) BVHNode {
+    GLfloat bounds[6][4];
+    GLint   child[4];
+    GLuint  count[4];
+};
+
+/**
+ * BVHTriangle struct
+ * Leaf copy of a face: corner v0, edges e1 = v1 - v0 and e2 = v2 - v0.
+ */
+struct BVHTriangle {
+    Vector3f v0, e1, e2;
+    GLuint face;
+};
+
+/**
+ * BVHHit struct
+ * Result of a query: the face, distance along the ray or to the point,
+ * and the barycentric coordinates (u, v) of the hit on it.
+ */
+struct BVHHit {
+    GLint face;
+    GLfloat t, u, v;
+
+    BVHHit(void) : face(-1), t(0.0f), u(0.0f), v(0.0f) {}
+};
+
+class BVH
+{
+public:
+    vector<BVHNode> nodes;              // root first, children after parents
+    vector<BVHTriangle> triangles;      // in leaf order
+
+    /**
+     * build
+     * Builds the tree over faces. Faces with an out of range index are
+     * left out.
+     */
+    void build(const vector<Vector3f> &verts, const vector<Triangle> &faces,
+        ThreadPool *pool);
+
+    /**
+     * refit
+     * Recomputes the leaf triangles and every box from moved vertices of
+     * the faces the tree was built over.
+     */
+    void refit(const vector<Vector3f> &verts, const vector<Triangle> &faces,
+        ThreadPool *pool);
+
+    /**
+     * intersect
+     * Finds the nearest face hit by origin + t * dir for 0 <= t < tmax.
+     * @return GLboolean - GL_TRUE if a face was hit
+     */
+    GLboolean intersect(const Vector3f &origin, const Vector3f &dir, BVHHit &hit,
+        GLfloat tmax = 1e30f) const;
+
+    /**
+     * closest
+     * Finds the point of the mesh nearest to p, no farther than max_dist.
+     * @return GLboolean - GL_TRUE if one was found
+     */
+    GLboolean closest(const Vector3f &p, BVHHit &hit, Vector3f &point,
+        GLfloat max_dist = 1e30f) const;
+
+    GLboolean empty(void) const
+        { return triangles.empty(); }
+};
+
+#endif
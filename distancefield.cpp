@@ -0,0 +1,153 @@
+#include "distancefield.h"
+
+#include <algorithm>
+#include <cmath>
+
+// Grid lines per parallel slice of the distance transform
+static const GLuint DT_GRAIN = 16;
+
+void Grid2D::fit(const vector<Vector3f> &outline, GLuint resolution, GLuint margin)
+{
+    Vector2f lo(1e30f, 1e30f), hi(-1e30f, -1e30f);
+
+    for (GLuint i = 0; i < outline.size(); i++) {
+        lo = lo.cwiseMin(outline[i].head<2>());
+        hi = hi.cwiseMax(outline[i].head<2>());
+    }
+    if (outline.empty()) lo = hi = Vector2f(0.0f, 0.0f);
+
+    Vector2f extent = hi - lo;
+    cell   = std::max(extent.maxCoeff(), 1.0f) / std::max(resolution, 1u);
+    origin = lo - Vector2f(margin, margin) * cell;
+    nx = (GLuint)ceil(extent.x() / cell) + 2 * margin + 1;
+    ny = (GLuint)ceil(extent.y() / cell) + 2 * margin + 1;
+}
+
+void rasterizeOutline(const vector<Vector3f> &outline, const Grid2D &grid,
+    vector<unsigned char> &inside)
+{
+    GLuint n = outline.size();
+    vector<GLfloat> cross;
+
+    inside.assign(grid.size(), 0);
+    if (n < 3) return;
+
+    for (GLuint j = 0; j < grid.ny; j++) {
+        GLfloat y = grid.origin.y() + j * grid.cell;
+
+        // Crossings of this scanline with the closed polygon
+        cross.clear();
+        for (GLuint k = 0; k < n; k++) {
+            const Vector3f &a = outline[k], &b = outline[(k + 1) % n];
+            if ((a.y() <= y) == (b.y() <= y)) continue;
+            GLfloat t = (y - a.y()) / (b.y() - a.y());
+            cross.push_back(a.x() + t * (b.x() - a.x()));
+        }
+        std::sort(cross.begin(), cross.end());
+
+        for (GLuint k = 0; k + 1 < cross.size(); k += 2) {
+            GLfloat x0 = (cross[k] - grid.origin.x()) / grid.cell;
+            GLfloat x1 = (cross[k + 1] - grid.origin.x()) / grid.cell;
+            GLint i0 = std::max((GLint)ceil(x0), 0);
+            GLint i1 = std::min((GLint)floor(x1), (GLint)grid.nx - 1);
+            for (GLint i = i0; i <= i1; i++)
+                inside[j * grid.nx + i] = 1;
+        }
+    }
+}
+
+/**
+ * transform1D
+ * Lower envelope of the parabolas f(q) + (p - q)^2 over n samples spaced
+ * stride apart, written back in place. v and z are scratch of n and n + 1.
+ */
+static void transform1D(GLfloat *f, GLuint n, GLuint stride, GLfloat *d,
+    GLint *v, GLfloat *z)
+{
+    GLint k = -1;
+
+    for (GLuint q = 0; q < n; q++) {
+        GLfloat fq = f[q * stride];
+        if (fq >= DT_INFINITY) continue;
+
+        // Drop parabolas the new one hides
+        GLfloat s = 0.0f;
+        while (k >= 0) {
+            GLint r = v[k];
+            s = ((fq + (GLfloat)q * q) - (f[r * stride] + (GLfloat)r * r)) / (2.0f * (q - r));
+            if (s > z[k]) break;
+            k--;
+        }
+        k++;
+        v[k] = q;
+        z[k] = (k == 0) ? -DT_INFINITY : s;
+        z[k + 1] = DT_INFINITY;
+    }
+
+    if (k < 0) return;  // nothing finite on this line
+
+    GLint j = 0;
+    for (GLuint p = 0; p < n; p++) {
+        while (z[j + 1] < p) j++;
+        GLfloat dp = (GLfloat)p - v[j];
+        d[p] = dp * dp + f[v[j] * stride];
+    }
+    for (GLuint p = 0; p < n; p++)
+        f[p * stride] = d[p];
+}
+
+void distanceTransform(vector<GLfloat> &f, GLuint nx, GLuint ny, ThreadPool *pool)
+{
+    GLfloat *data = f.data();
+
+    auto columns = [=](GLuint begin, GLuint end) {
+        vector<GLfloat> d(ny), z(ny + 1);
+        vector<GLint> v(ny);
+        for (GLuint i = begin; i < end; i++)
+            transform1D(data + i, ny, nx, d.data(), v.data(), z.data());
+    };
+    auto rows = [=](GLuint begin, GLuint end) {
+        vector<GLfloat> d(nx), z(nx + 1);
+        vector<GLint> v(nx);
+        for (GLuint j = begin; j < end; j++)
+            transform1D(data + j * nx, nx, 1, d.data(), v.data(), z.data());
+    };
+
+    if (pool) {
+        pool->parallelFor(0, nx, DT_GRAIN, columns);
+        pool->parallelFor(0, ny, DT_GRAIN, rows);
+    } else {
+        columns(0, nx);
+        rows(0, ny);
+    }
+}
+
+void insideDistance(const vector<unsigned char> &inside, GLuint nx, GLuint ny,
+    vector<GLfloat> &dist, ThreadPool *pool)
+{
+    dist.resize(nx * ny);
+    for (GLuint i = 0; i < dist.size(); i++)
+        dist[i] = inside[i] ? DT_INFINITY : 0.0f;
+
+    distanceTransform(dist, nx, ny, pool);
+
+    for (GLuint i = 0; i < dist.size(); i++)
+        dist[i] = inside[i] ? std::max(sqrtf(dist[i]) - 0.5f, 0.0f) : 0.0f;
+}
+
+GLfloat medialPower(const vector<unsigned char> &inside, const vector<GLfloat> &dist,
+    GLuint nx, GLuint ny, vector<GLfloat> &power, ThreadPool *pool)
+{
+    GLfloat peak = -DT_INFINITY;
+
+    // -P is the lower envelope of -d(q)^2 + |p - q|^2 over inside nodes
+    power.resize(nx * ny);
+    for (GLuint i = 0; i < power.size(); i++)
+        power[i] = inside[i] ? -dist[i] * dist[i] : DT_INFINITY;
+    distanceTransform(power, nx, ny, pool);
+    for (GLuint i = 0; i < power.size(); i++) {
+        power[i] = -power[i];
+        peak = std::max(peak, power[i]);
+    }
+    return peak;
+}
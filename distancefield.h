@@ -0,0 +1,89 @@
+/**
+ * distancefield.h
+ * This file contains the raster helpers shared by the grid-based inflation
+ * engines: scanline rasterization of the closed sketch outline, and the
+ * separable squared distance transform of Felzenszwalb & Huttenlocher,
+ * which runs in linear time per grid line for any sampled function.
+ */
+
+#ifndef _DISTANCEFIELD_H_
+#define _DISTANCEFIELD_H_
+
+#ifdef __APPLE__
+#include <OpenGL/gl.h>
+#else
+#include <GL/gl.h>
+#endif
+
+#include <vector>
+#include <Eigen/Core>
+#include "threadpool.h"
+
+using std::vector;
+using Eigen::Vector2f;
+using Eigen::Vector3f;
+
+// Stand-in for +infinity that keeps the envelope arithmetic finite
+const GLfloat DT_INFINITY = 1e20f;
+
+/**
+ * Grid2D struct
+ * Node layout of a raster: node (i, j) sits at origin + cell * (i, j) and
+ * is stored at j * nx + i.
+ */
+struct Grid2D {
+    Vector2f origin;
+    GLfloat  cell;
+    GLuint   nx, ny;
+
+    Grid2D(void) : origin(0.0f, 0.0f), cell(1.0f), nx(0), ny(0) {}
+
+    /**
+     * fit
+     * Covers the outline's bounding box with about resolution cells across
+     * its longer side, plus margin empty cells on every side.
+     */
+    void fit(const vector<Vector3f> &outline, GLuint resolution, GLuint margin);
+
+    GLuint size(void) const
+        { return nx * ny; }
+};
+
+/**
+ * rasterizeOutline
+ * Sets inside[j * nx + i] to 1 for every node inside the closed polygon
+ * (even-odd rule), 0 elsewhere.
+ */
+void rasterizeOutline(const vector<Vector3f> &outline, const Grid2D &grid,
+    vector<unsigned char> &inside);
+
+/**
+ * distanceTransform
+ * In place, f(p) <- min over q of f(q) + |p - q|^2 in cell units. Nodes set
+ * to DT_INFINITY take part only as receivers. Rows and columns are split
+ * across the pool when one is given.
+ */
+void distanceTransform(vector<GLfloat> &f, GLuint nx, GLuint ny, ThreadPool *pool);
+
+/**
+ * insideDistance
+ * Distance in cells from every node to the outline, positive inside and
+ * zero outside, from the exact transform of the inside mask. The boundary
+ * is taken halfway between inside and outside nodes.
+ */
+void insideDistance(const vector<unsigned char> &inside, GLuint nx, GLuint ny,
+    vector<GLfloat> &dist, ThreadPool *pool);
+
+/**
+ * medialPower
+ * P(p) = max over inside nodes q of dist(q)^2 - |p - q|^2, in cells^2: the
+ * power of p with respect to the union of inscribed disks. P is positive
+ * inside and negative outside, and sqrt(P) is the height of the union of
+ * inscribed balls, d (2R - d) under the largest disk of radius R covering
+ * the node.
+ * @return GLfloat - the largest P
+ */
+GLfloat medialPower(const vector<unsigned char> &inside, const vector<GLfloat> &dist,
+    GLuint nx, GLuint ny, vector<GLfloat> &power, ThreadPool *pool);
+
+#endif
@@ -0,0 +1,67 @@
+#include "eventqueue.h"
+
+#include <chrono>
+
+EventQueue::EventQueue(void)
+    : pushed(0), dropped(0), popped(0), latency_total_us(0), latency_max_us(0),
+      ring(EVENT_CAPACITY), head(0), tail(0)
+{
+}
+
+GLdouble EventQueue::now(void)
+{
+    return std::chrono::duration<GLdouble, std::milli>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+GLboolean EventQueue::push(GLint type, GLint x, GLint y)
+{
+    // Indices run freely and wrap; their difference is the fill
+    GLuint t = tail.load(std::memory_order_relaxed);
+    if (t - head.load(std::memory_order_acquire) == EVENT_CAPACITY) {
+        dropped.fetch_add(1, std::memory_order_relaxed);
+        return GL_FALSE;
+    }
+
+    InputEvent &slot = ring[t & (EVENT_CAPACITY - 1)];
+    slot.type = type;
+    slot.x = x;
+    slot.y = y;
+    slot.time = now();
+    tail.store(t + 1, std::memory_order_release);
+    pushed.fetch_add(1, std::memory_order_relaxed);
+    return GL_TRUE;
+}
+
+GLboolean EventQueue::pop(InputEvent &event)
+{
+    GLuint h = head.load(std::memory_order_relaxed);
+    if (h == tail.load(std::memory_order_acquire)) return GL_FALSE;
+
+    event = ring[h & (EVENT_CAPACITY - 1)];
+    head.store(h + 1, std::memory_order_release);
+
+    GLdouble waited = now() - event.time;
+    unsigned long long us = waited > 0.0 ? (unsigned long long)(waited * 1000.0) : 0;
+    latency_total_us.fetch_add(us, std::memory_order_relaxed);
+    if (us > latency_max_us.load(std::memory_order_relaxed))
+        latency_max_us.store(us, std::memory_order_relaxed);
+    popped.fetch_add(1, std::memory_order_relaxed);
+    return GL_TRUE;
+}
+
+void EventQueue::discard(void)
+{
+    head.store(tail.load(std::memory_order_acquire), std::memory_order_release);
+}
+
+GLdouble EventQueue::meanLatency(void) const
+{
+    GLuint n = popped.load(std::memory_order_relaxed);
+    return n ? latency_total_us.load(std::memory_order_relaxed) / 1000.0 / n : 0.0;
+}
+
+GLdouble EventQueue::maxLatency(void) const
+{
+    return latency_max_us.load(std::memory_order_relaxed) / 1000.0;
+}
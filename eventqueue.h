@@ -0,0 +1,95 @@
+/**
+ * eventqueue.h
+ * This file contains the EventQueue class, a bounded ring of timestamped
+ * input events from one producer thread to one consumer thread. Both ends
+ * are wait-free: push and pop each touch their own index and read the
+ * other's, and a push into a full ring drops the event and counts it
+ * instead of waiting. The consumer keeps the latency from push to pop.
+ */
+
+#ifndef _EVENTQUEUE_H_
+#define _EVENTQUEUE_H_
+
+#ifdef __APPLE__
+#include <OpenGL/gl.h>
+#else
+#include <GL/gl.h>
+#endif
+
+#include <atomic>
+#include <vector>
+
+using std::vector;
+
+// Events the ring holds, a power of two
+const GLuint EVENT_CAPACITY = 4096;
+
+enum InputType { INPUT_DOWN, INPUT_MOTION, INPUT_UP };
+
+/**
+ * InputEvent struct
+ * A mouse event in window coordinates, stamped with the time it was pushed.
+ */
+struct InputEvent {
+    GLint    type;
+    GLint    x, y;
+    GLdouble time;      // milliseconds, steady clock
+};
+
+class EventQueue
+{
+public:
+    // Producer counters
+    std::atomic<GLuint> pushed, dropped;
+
+    // Consumer counters, and push to pop latency in microseconds
+    std::atomic<GLuint> popped;
+    std::atomic<unsigned long long> latency_total_us, latency_max_us;
+
+    EventQueue(void);
+
+    /**
+     * push
+     * Producer side: stamps and appends an event.
+     * @return GLboolean - GL_FALSE if the ring was full and it was dropped
+     */
+    GLboolean push(GLint type, GLint x, GLint y);
+
+    /**
+     * pop
+     * Consumer side: takes the oldest event.
+     * @return GLboolean - GL_FALSE if the ring was empty
+     */
+    GLboolean pop(InputEvent &event);
+
+    /**
+     * discard
+     * Consumer side: drops every queued event without counting latency.
+     */
+    void discard(void);
+
+    /**
+     * meanLatency & maxLatency
+     * @return GLdouble - push to pop latency in milliseconds
+     */
+    GLdouble meanLatency(void) const;
+    GLdouble maxLatency(void) const;
+
+    /**
+     * now
+     * @return GLdouble - the steady clock in milliseconds, as in stamps
+     */
+    static GLdouble now(void);
+
+private:
+    vector<InputEvent> ring;
+
+    // Each index on its own cache line, so the ends do not share one
+    alignas(64) std::atomic<GLuint> head;   // next to pop, consumer owned
+    alignas(64) std::atomic<GLuint> tail;   // next to push, producer owned
+
+    EventQueue(const EventQueue &);
+    EventQueue &operator=(const EventQueue &);
+};
+
+#endif
@@ -0,0 +1,175 @@
+#include "fairing.h"
+
+#include <algorithm>
+#include <cmath>
+
+unsigned long long faceHash(GLuint n, const vector<Triangle> &faces)
+{
+    unsigned long long h = 14695981039346656037ULL;
+    auto mix = [&h](GLuint v) {
+        h = (h ^ v) * 1099511628211ULL;
+    };
+
+    mix(n);
+    for (GLuint f = 0; f < faces.size(); f++) {
+        mix(faces[f].vertex1);
+        mix(faces[f].vertex2);
+        mix(faces[f].vertex3);
+    }
+    return h;
+}
+
+GLfloat meshExtent(const vector<Vector3f> &verts)
+{
+    if (verts.empty()) return 0.0f;
+
+    Vector3f lo = verts[0], hi = verts[0];
+    for (GLuint i = 1; i < verts.size(); i++) {
+        lo = lo.cwiseMin(verts[i]);
+        hi = hi.cwiseMax(verts[i]);
+    }
+    return (hi - lo).maxCoeff();
+}
+
+void Fairing::clear(void)
+{
+    vertex_count = 0;
+    topology = 0;
+    system.resize(0, 0);
+    edge_slots.clear();
+    diagonal_slots.clear();
+}
+
+GLint Fairing::slot(GLuint row, GLuint col) const
+{
+    const int *begin = system.innerIndexPtr() + system.outerIndexPtr()[col];
+    const int *end   = system.innerIndexPtr() + system.outerIndexPtr()[col + 1];
+    const int *it    = std::lower_bound(begin, end, (int)row);
+
+    return (GLint)(it - system.innerIndexPtr());
+}
+
+/**
+ * analyze
+ * Builds the pattern of the system from the face edges, maps every edge
+ * to its nonzeros and runs the symbolic factorization.
+ */
+void Fairing::analyze(GLuint n, const vector<Triangle> &faces)
+{
+    vector<Eigen::Triplet<double> > entries;
+    GLuint f, e;
+
+    entries.reserve(n + 6 * faces.size());
+    for (GLuint i = 0; i < n; i++)
+        entries.push_back(Eigen::Triplet<double>(i, i, 1.0));
+    for (f = 0; f < faces.size(); f++) {
+        const GLuint v[3] = { faces[f].vertex1, faces[f].vertex2, faces[f].vertex3 };
+        for (e = 0; e < 3; e++) {
+            entries.push_back(Eigen::Triplet<double>(v[e], v[(e + 1) % 3], 1.0));
+            entries.push_back(Eigen::Triplet<double>(v[(e + 1) % 3], v[e], 1.0));
+        }
+    }
+    system.resize(n, n);
+    system.setFromTriplets(entries.begin(), entries.end());
+    system.makeCompressed();
+
+    diagonal_slots.resize(n);
+    for (GLuint i = 0; i < n; i++)
+        diagonal_slots[i] = slot(i, i);
+    edge_slots.resize(6 * faces.size());
+    for (f = 0; f < faces.size(); f++) {
+        const GLuint v[3] = { faces[f].vertex1, faces[f].vertex2, faces[f].vertex3 };
+        for (e = 0; e < 3; e++) {
+            edge_slots[6 * f + 2 * e]     = slot(v[e], v[(e + 1) % 3]);
+            edge_slots[6 * f + 2 * e + 1] = slot(v[(e + 1) % 3], v[e]);
+        }
+    }
+
+    solver.analyzePattern(system);
+    analyses++;
+}
+
+/**
+ * weigh
+ * Fills the Laplacian L = D - W. Every face adds half a weight to each of
+ * its edges: 1/2 for the uniform graph Laplacian, half the cotangent of
+ * the opposite angle otherwise, clamped at zero to keep L semidefinite.
+ */
+void Fairing::weigh(const vector<Vector3f> &rest, const vector<Triangle> &faces,
+    FairingWeights type)
+{
+    laplacian.assign(system.nonZeros(), 0.0);
+
+    for (GLuint f = 0; f < faces.size(); f++) {
+        const GLuint v[3] = { faces[f].vertex1, faces[f].vertex2, faces[f].vertex3 };
+
+        for (GLuint e = 0; e < 3; e++) {
+            GLuint a = v[e], b = v[(e + 1) % 3], c = v[(e + 2) % 3];
+            double w = 0.5;
+
+            if (type == FAIRING_COTANGENT) {
+                Vector3f ca = rest[a] - rest[c], cb = rest[b] - rest[c];
+                GLfloat sine = ca.cross(cb).norm();
+                w = (sine > 0.0f) ? std::max(0.5 * ca.dot(cb) / sine, 0.0) : 0.0;
+            }
+            laplacian[edge_slots[6 * f + 2 * e]]     -= w;
+            laplacian[edge_slots[6 * f + 2 * e + 1]] -= w;
+            laplacian[diagonal_slots[a]] += w;
+            laplacian[diagonal_slots[b]] += w;
+        }
+    }
+}
+
+/**
+ * pin
+ * Gives the silhouette vertices the pinning mass and every other vertex
+ * mass 1.
+ */
+void Fairing::pin(GLuint n, const vector<GLuint> &silhouette)
+{
+    mass.assign(n, 1.0);
+    for (GLuint i = 0; i < silhouette.size(); i++)
+        if (silhouette[i] < n) mass[silhouette[i]] = FAIRING_PIN;
+}
+
+GLboolean Fairing::fair(const vector<Vector3f> &rest, const vector<Triangle> &faces,
+    const vector<GLuint> &silhouette, GLfloat weight, FairingWeights type,
+    vector<Vector3f> &out)
+{
+    GLuint n = rest.size(), i;
+
+    out = rest;
+    if (n == 0 || faces.empty()) return GL_FALSE;
+    if (weight <= 0.0f) return GL_TRUE;
+
+    // Only a new topology needs a new pattern and symbolic analysis
+    unsigned long long key = faceHash(n, faces);
+    if (n != vertex_count || key != topology) {
+        analyze(n, faces);
+        vertex_count = n;
+        topology = key;
+    }
+
+    weigh(rest, faces, type);
+    pin(n, silhouette);
+
+    double *values = system.valuePtr();
+    for (i = 0; i < laplacian.size(); i++)
+        values[i] = weight * laplacian[i];
+    for (i = 0; i < n; i++)
+        values[diagonal_slots[i]] += mass[i];
+
+    solver.factorize(system);
+    factorizations++;
+    if (solver.info() != Eigen::Success) return GL_FALSE;
+
+    rhs.resize(n, 3);
+    for (i = 0; i < n; i++)
+        rhs.row(i) = mass[i] * rest[i].cast<double>().transpose();
+    solution = solver.solve(rhs);
+    if (solver.info() != Eigen::Success) return GL_FALSE;
+
+    for (i = 0; i < n; i++)
+        out[i] = solution.row(i).transpose().cast<float>();
+    return GL_TRUE;
+}
@@ -0,0 +1,102 @@
+/**
+ * fairing.h
+ * This file contains the Fairing class, which smooths inflated meshes by
+ * one implicit Laplacian step. With rest positions x0, mass M and the
+ * Laplacian L of the mesh graph it solves
+ *
+ *     (M + w L) x = M x0,
+ *
+ * for all three coordinates at once. Silhouette vertices, as reported by
+ * the inflation engine, get a very large mass, which pins them to the
+ * sketched outline. The system is
+ * symmetric positive definite and shares its sparsity pattern with the
+ * mesh, so the symbolic LDLT analysis is kept until the faces change and a
+ * new weight costs one numeric factorization.
+ */
+
+#ifndef _FAIRING_H_
+#define _FAIRING_H_
+
+#ifdef __APPLE__
+#include <OpenGL/gl.h>
+#else
+#include <GL/gl.h>
+#endif
+
+#include <vector>
+#include <Eigen/Core>
+#include <Eigen/SparseCore>
+#include <Eigen/SparseCholesky>
+#include "mesh.h"
+
+using std::vector;
+using Eigen::Vector3f;
+
+enum FairingWeights { FAIRING_UNIFORM, FAIRING_COTANGENT };
+
+// Mass of a pinned vertex; free vertices have mass 1
+const double FAIRING_PIN = 1e6;
+
+/**
+ * meshExtent
+ * Longest side of the bounding box of verts.
+ */
+GLfloat meshExtent(const vector<Vector3f> &verts);
+
+/**
+ * faceHash
+ * FNV-1a over the vertex count and face indices; a new value means a new
+ * topology.
+ */
+unsigned long long faceHash(GLuint n, const vector<Triangle> &faces);
+
+class Fairing
+{
+public:
+    // Symbolic analyses and numeric factorizations since construction
+    GLuint analyses, factorizations;
+
+    Fairing(void) : analyses(0), factorizations(0), vertex_count(0), topology(0) {}
+
+    /**
+     * fair
+     * Writes the faired rest positions to out, which must not be rest,
+     * keeping the silhouette vertices in place. Weight 0 returns the rest
+     * positions unchanged.
+     * @return GLboolean - GL_FALSE if the mesh is empty or the system
+     *                     could not be factorized; out is then rest
+     */
+    GLboolean fair(const vector<Vector3f> &rest, const vector<Triangle> &faces,
+        const vector<GLuint> &silhouette, GLfloat weight, FairingWeights type,
+        vector<Vector3f> &out);
+
+    /**
+     * clear
+     * Forgets the cached analysis.
+     */
+    void clear(void);
+
+private:
+    typedef Eigen::SparseMatrix<double> SparseMatrix;
+
+    GLuint vertex_count;
+    unsigned long long topology;        // hash of the analyzed faces
+    SparseMatrix system;
+    Eigen::SimplicialLDLT<SparseMatrix> solver;
+
+    // Nonzero slots of (a, b) and (b, a) for every face edge, and of the
+    // diagonal for every vertex
+    vector<GLint> edge_slots, diagonal_slots;
+
+    vector<double> laplacian;           // L per nonzero
+    vector<double> mass;                // M per vertex
+    Eigen::MatrixX3d rhs, solution;
+
+    void analyze(GLuint n, const vector<Triangle> &faces);
+    void weigh(const vector<Vector3f> &rest, const vector<Triangle> &faces,
+        FairingWeights type);
+    void pin(GLuint n, const vector<GLuint> &silhouette);
+    GLint slot(GLuint row, GLuint col) const;
+};
+
+#endif
@@ -0,0 +1,128 @@
+#include "halfedge.h"
+
+// Half-edges or vertices per parallel slice
+static const GLuint HALFEDGE_GRAIN = 4096;
+
+/**
+ * forRange
+ * Runs body over [0, n), split across the pool when given.
+ */
+template <class F>
+static void forRange(ThreadPool *pool, GLuint n, F body)
+{
+    auto slice = [&](GLuint begin, GLuint end) {
+        for (GLuint i = begin; i < end; i++) body(i);
+    };
+    if (pool) pool->parallelFor(0, n, HALFEDGE_GRAIN, slice);
+    else      slice(0, n);
+}
+
+void HalfEdgeMesh::build(GLuint n, const vector<Triangle> &faces, ThreadPool *pool)
+{
+    vert.clear();
+    vert.reserve(3 * faces.size());
+    for (GLuint f = 0; f < faces.size(); f++) {
+        GLuint a = faces[f].vertex1, b = faces[f].vertex2, c = faces[f].vertex3;
+        if (a >= n || b >= n || c >= n || a == b || b == c || c == a)
+            continue;
+        vert.push_back(a);
+        vert.push_back(b);
+        vert.push_back(c);
+    }
+    GLuint nh = vert.size();
+
+    // Outgoing half-edges of every vertex, bucketed by origin
+    vector<GLuint> first(n + 1, 0), outgoing(nh);
+    for (GLuint h = 0; h < nh; h++)
+        first[vert[h] + 1]++;
+    for (GLuint v = 0; v < n; v++)
+        first[v + 1] += first[v];
+    vector<GLuint> fill(first.begin(), first.end() - 1);
+    for (GLuint h = 0; h < nh; h++)
+        outgoing[fill[vert[h]]++] = h;
+
+    // An edge with exactly one half-edge each way is manifold
+    twin.resize(nh);
+    forRange(pool, nh, [&](GLuint h) {
+        GLint a = vert[h], b = dest(h), found = -1;
+        GLuint matches = 0, same = 0;
+
+        for (GLuint k = first[b]; k < first[b + 1]; k++)
+            if (dest(outgoing[k]) == a) { found = outgoing[k]; matches++; }
+        for (GLuint k = first[a]; k < first[a + 1]; k++)
+            same += dest(outgoing[k]) == b;
+        twin[h] = (matches == 1 && same == 1) ? found : -1;
+    });
+
+    // Boundary vertices start their fan at an unpaired half-edge
+    out.resize(n);
+    valence.resize(n);
+    forRange(pool, n, [&](GLuint v) {
+        valence[v] = first[v + 1] - first[v];
+        out[v] = valence[v] ? (GLint)outgoing[first[v]] : -1;
+        for (GLuint k = first[v]; k < first[v + 1]; k++)
+            if (twin[outgoing[k]] < 0) { out[v] = outgoing[k]; break; }
+    });
+}
+
+GLboolean HalfEdgeMesh::interior(GLint v) const
+{
+    GLint h = out[v];
+    GLint steps = 0;
+
+    if (h < 0 || twin[h] < 0) return GL_FALSE;
+    do {
+        h = rotate(h);
+        steps++;
+    } while (h >= 0 && h != out[v] && steps <= valence[v]);
+    return (h == out[v] && steps == valence[v]) ? GL_TRUE : GL_FALSE;
+}
+
+void HalfEdgeMesh::neighbors(GLint v, vector<GLint> &ring) const
+{
+    GLint h = out[v];
+
+    ring.clear();
+    if (h < 0) return;
+    do {
+        ring.push_back(dest(h));
+        if (rotate(h) < 0) {
+            ring.push_back(vert[prev(h)]);
+            return;
+        }
+        h = rotate(h);
+    } while (h != out[v] && ring.size() <= (GLuint)valence[v]);
+}
+
+void HalfEdgeMesh::triangles(vector<Triangle> &faces) const
+{
+    faces.clear();
+    faces.reserve(faceCount());
+    for (GLuint h = 0; h < vert.size(); h += 3)
+        if (vert[h] >= 0)
+            faces.push_back(Triangle(vert[h], vert[h + 1], vert[h + 2]));
+}
+
+void HalfEdgeMesh::extract(const vector<Vector3f> &pos, vector<Vector3f> &verts,
+    vector<Triangle> &faces, vector<GLint> *renumber) const
+{
+    vector<GLint> local;
+    vector<GLint> &index = renumber ? *renumber : local;
+    index.assign(pos.size(), -1);
+
+    verts.clear();
+    faces.clear();
+    for (GLuint h = 0; h < vert.size(); h += 3) {
+        if (vert[h] < 0) continue;
+        GLuint c[3];
+        for (GLuint k = 0; k < 3; k++) {
+            GLint v = vert[h + k];
+            if (index[v] < 0) {
+                index[v] = verts.size();
+                verts.push_back(pos[v]);
+            }
+            c[k] = index[v];
+        }
+        faces.push_back(Triangle(c[0], c[1], c[2]));
+    }
+}
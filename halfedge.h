@@ -0,0 +1,89 @@
+/**
+ * halfedge.h
+ * This file contains the HalfEdgeMesh class, an index-based half-edge
+ * structure over triangle faces held in flat arrays. Half-edge h is corner
+ * h % 3 of face h / 3 and runs from vert[h] to the next corner's vertex,
+ * so next, prev and face are arithmetic and only twins and one outgoing
+ * half-edge per vertex are stored. Every neighborhood query is O(1) per
+ * element visited.
+ *
+ * Twins are matched by bucketing half-edges by origin with a counting
+ * sort and scanning the destination's bucket, O(F) overall. An edge is
+ * paired only when it has exactly one half-edge each way; boundary and
+ * non-manifold half-edges keep twin -1.
+ */
+
+#ifndef _HALFEDGE_H_
+#define _HALFEDGE_H_
+
+#ifdef __APPLE__
+#include <OpenGL/gl.h>
+#else
+#include <GL/gl.h>
+#endif
+
+#include <vector>
+#include <Eigen/Core>
+#include "mesh.h"
+#include "threadpool.h"
+
+using std::vector;
+using Eigen::Vector3f;
+
+class HalfEdgeMesh
+{
+public:
+    vector<GLint> vert;         // origin per half-edge; -1 for dead faces
+    vector<GLint> twin;         // opposite half-edge, -1 if unpaired
+    vector<GLint> out;          // an outgoing half-edge per vertex, -1 if none;
+                                // unpaired when the vertex is on a boundary
+    vector<GLint> valence;      // outgoing half-edges per vertex
+
+    static GLint next(GLint h) { return h - h % 3 + (h + 1) % 3; }
+    static GLint prev(GLint h) { return h - h % 3 + (h + 2) % 3; }
+    static GLint face(GLint h) { return h / 3; }
+    GLint dest(GLint h) const { return vert[next(h)]; }
+
+    // Next outgoing half-edge around the origin of h, -1 past a boundary
+    GLint rotate(GLint h) const { return twin[prev(h)]; }
+
+    GLuint vertexCount(void) const { return out.size(); }
+    GLuint faceCount(void) const { return vert.size() / 3; }
+
+    /**
+     * build
+     * Builds the structure for n vertices from indexed triangles. Faces
+     * with an out of range or repeated index are skipped.
+     */
+    void build(GLuint n, const vector<Triangle> &faces, ThreadPool *pool);
+
+    /**
+     * interior
+     * @return GLboolean - GL_TRUE if the faces around v form one closed fan
+     */
+    GLboolean interior(GLint v) const;
+
+    /**
+     * neighbors
+     * Fills ring with the vertices adjacent to v in fan order. Only the
+     * fan through out[v] is visited at a non-manifold vertex.
+     */
+    void neighbors(GLint v, vector<GLint> &ring) const;
+
+    /**
+     * triangles
+     * Writes the live faces back as rendering indices.
+     */
+    void triangles(vector<Triangle> &faces) const;
+
+    /**
+     * extract
+     * Writes the live faces and the positions they reference, renumbering
+     * vertices in order of first use and dropping unreferenced ones. If
+     * given, index receives every vertex's new number, or -1 if dropped.
+     */
+    void extract(const vector<Vector3f> &pos, vector<Vector3f> &verts,
+        vector<Triangle> &faces, vector<GLint> *index = NULL) const;
+};
+
+#endif
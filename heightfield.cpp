@@ -0,0 +1,220 @@
+#include "heightfield.h"
+
+#include <cmath>
+
+// Rows per parallel slice
+static const GLuint HEIGHTFIELD_GRAIN = 8;
+
+/**
+ * forRows
+ * Runs body over rows [0, n), split across the pool when given.
+ */
+template <class F>
+static void forRows(ThreadPool *pool, GLuint n, F body)
+{
+    auto slice = [&](GLuint begin, GLuint end) {
+        for (GLuint j = begin; j < end; j++) body(j);
+    };
+    if (pool) pool->parallelFor(0, n, HEIGHTFIELD_GRAIN, slice);
+    else      slice(0, n);
+}
+
+/**
+ * prefixSum
+ * Turns per-row counts into starting offsets.
+ * @return GLuint - the total
+ */
+static GLuint prefixSum(vector<GLuint> &counts)
+{
+    GLuint total = 0;
+    for (GLuint j = 0; j < counts.size(); j++) {
+        GLuint n = counts[j];
+        counts[j] = total;
+        total += n;
+    }
+    return total;
+}
+
+void HeightField::clear(void)
+{
+    power.clear();
+    grid.nx = grid.ny = 0;
+}
+
+GLboolean HeightField::build(const vector<Vector3f> &outline, GLuint resolution,
+    ThreadPool *pool)
+{
+    clear();
+    if (outline.size() < 3) return GL_FALSE;
+
+    grid.fit(outline, resolution, 1);
+    rasterizeOutline(outline, grid, inside);
+    insideDistance(inside, grid.nx, grid.ny, dist, pool);
+
+    // The medial power is d (2R - d) for the largest covering circle
+    if (medialPower(inside, dist, grid.nx, grid.ny, power, pool) <= 0.0f) {
+        clear();
+        return GL_FALSE;
+    }
+    return GL_TRUE;
+}
+
+/**
+ * crossing
+ * Silhouette point on the edge between nodes a and b, where the linear
+ * interpolation of the squared height reaches zero.
+ */
+Vector3f HeightField::crossing(GLuint a, GLuint b) const
+{
+    GLfloat t = power[a] / (power[a] - power[b]);
+    GLfloat ia = a % grid.nx, ja = a / grid.nx;
+    GLfloat ib = b % grid.nx, jb = b / grid.nx;
+
+    return Vector3f(grid.origin.x() + (ia + t * (ib - ia)) * grid.cell,
+                    grid.origin.y() + (ja + t * (jb - ja)) * grid.cell, 0.0f);
+}
+
+/**
+ * countRow
+ * Vertices owned by row j: two per inside node, and one per silhouette
+ * crossing on the right, up and up-right edges leaving the row's nodes.
+ */
+GLuint HeightField::countRow(GLuint j) const
+{
+    GLuint nx = grid.nx, count = 0;
+
+    for (GLuint i = 0; i < nx; i++) {
+        GLuint n = j * nx + i;
+        GLboolean in = power[n] > 0.0f;
+
+        count += in ? 2 : 0;
+        if (i + 1 < nx)
+            count += (power[n + 1] > 0.0f) != in;
+        if (j + 1 < grid.ny)
+            count += (power[n + nx] > 0.0f) != in;
+        if (i + 1 < nx && j + 1 < grid.ny)
+            count += (power[n + nx + 1] > 0.0f) != in;
+    }
+    return count;
+}
+
+void HeightField::fillRow(GLuint j, vector<Vector3f> &verts)
+{
+    GLuint nx = grid.nx, v = row_vertices[j];
+
+    for (GLuint i = 0; i < nx; i++) {
+        GLuint n = j * nx + i;
+        GLboolean in = power[n] > 0.0f;
+
+        node_vertex[n] = right_vertex[n] = up_vertex[n] = diag_vertex[n] = -1;
+        if (in) {
+            GLfloat x = grid.origin.x() + i * grid.cell;
+            GLfloat y = grid.origin.y() + j * grid.cell;
+            GLfloat h = sqrtf(power[n]) * grid.cell;
+
+            node_vertex[n] = v;
+            verts[v++] = Vector3f(x, y, h);
+            verts[v++] = Vector3f(x, y, -h);
+        }
+        if (i + 1 < nx && (power[n + 1] > 0.0f) != in) {
+            right_vertex[n] = v;
+            verts[v++] = crossing(n, n + 1);
+        }
+        if (j + 1 < grid.ny && (power[n + nx] > 0.0f) != in) {
+            up_vertex[n] = v;
+            verts[v++] = crossing(n, n + nx);
+        }
+        if (i + 1 < nx && j + 1 < grid.ny && (power[n + nx + 1] > 0.0f) != in) {
+            diag_vertex[n] = v;
+            verts[v++] = crossing(n, n + nx + 1);
+        }
+    }
+}
+
+/**
+ * cellFaces
+ * Splits every cell of row j into two triangles along its up-right
+ * diagonal and clips each to the inside region. The clipped polygon is
+ * fanned once at +h and once, reversed, at -h; its silhouette vertices are
+ * shared, which stitches the two sheets together.
+ * @return GLuint - faces of the row; out may be NULL to only count them
+ */
+GLuint HeightField::cellFaces(GLuint j, Triangle *out) const
+{
+    GLuint nx = grid.nx, count = 0;
+
+    for (GLuint i = 0; i + 1 < nx; i++) {
+        GLuint a = j * nx + i, b = a + 1, c = a + nx + 1, d = a + nx;
+
+        // Corners and edge crossings of triangles ABC and ACD, CCW in xy
+        const GLuint tris[2][3] = { { a, b, c }, { a, c, d } };
+        const GLint  cuts[2][3] = {
+            { right_vertex[a], up_vertex[b],  diag_vertex[a] },
+            { diag_vertex[a],  right_vertex[d], up_vertex[a] }
+        };
+
+        for (GLuint t = 0; t < 2; t++) {
+            GLint front[4], back[4];
+            GLuint m = 0;
+
+            for (GLuint k = 0; k < 3; k++) {
+                GLuint p = tris[t][k], q = tris[t][(k + 1) % 3];
+                GLboolean in = power[p] > 0.0f;
+
+                if (in) {
+                    front[m] = node_vertex[p];
+                    back[m]  = node_vertex[p] + 1;
+                    m++;
+                }
+                if (in != (power[q] > 0.0f)) {
+                    front[m] = back[m] = cuts[t][k];
+                    m++;
+                }
+            }
+            if (m < 3) continue;
+
+            for (GLuint k = 1; k + 1 < m; k++) {
+                if (out) {
+                    *out++ = Triangle(front[0], front[k], front[k + 1]);
+                    *out++ = Triangle(back[0], back[k + 1], back[k]);
+                }
+                count += 2;
+            }
+        }
+    }
+    return count;
+}
+
+void HeightField::extract(vector<Vector3f> &verts, vector<Triangle> &faces,
+    vector<GLuint> &silhouette, ThreadPool *pool)
+{
+    GLuint ny = grid.ny;
+
+    verts.clear();
+    faces.clear();
+    silhouette.clear();
+    if (power.empty()) return;
+
+    node_vertex.resize(grid.size());
+    right_vertex.resize(grid.size());
+    up_vertex.resize(grid.size());
+    diag_vertex.resize(grid.size());
+    row_vertices.resize(ny);
+    row_faces.resize(ny - 1);
+
+    // Count, offset and fill vertices by rows, then the same for faces
+    forRows(pool, ny, [this](GLuint j) { row_vertices[j] = countRow(j); });
+    verts.resize(prefixSum(row_vertices));
+    forRows(pool, ny, [&](GLuint j) { fillRow(j, verts); });
+
+    forRows(pool, ny - 1, [this](GLuint j) { row_faces[j] = cellFaces(j, NULL); });
+    faces.resize(prefixSum(row_faces));
+    forRows(pool, ny - 1, [&](GLuint j) { cellFaces(j, faces.data() + row_faces[j]); });
+
+    // Every edge crossing is a silhouette vertex, numbered in node order
+    for (GLuint n = 0; n < grid.size(); n++) {
+        if (right_vertex[n] >= 0) silhouette.push_back(right_vertex[n]);
+        if (up_vertex[n] >= 0)    silhouette.push_back(up_vertex[n]);
+        if (diag_vertex[n] >= 0)  silhouette.push_back(diag_vertex[n]);
+    }
+}
@@ -0,0 +1,81 @@
+/**
+ * heightfield.h
+ * This file contains the HeightField class, a raster inflation engine. The
+ * closed stroke is rasterized, an exact Euclidean distance transform gives
+ * every inside pixel its distance d to the outline, and the height is
+ *
+ *     h = sqrt(d (2R - d)),
+ *
+ * with R the radius of the largest inscribed circle over the pixel, which
+ * rounds every cross section into a half circle. Front and back grid meshes
+ * at +h and -h share their silhouette vertices, so the result is closed.
+ * Work is linear in the pixel count, split by rows, and never fails on
+ * self-intersecting or nested outlines (even-odd fill).
+ */
+
+#ifndef _HEIGHTFIELD_H_
+#define _HEIGHTFIELD_H_
+
+#ifdef __APPLE__
+#include <OpenGL/gl.h>
+#else
+#include <GL/gl.h>
+#endif
+
+#include <vector>
+#include <Eigen/Core>
+#include "mesh.h"
+#include "distancefield.h"
+#include "threadpool.h"
+
+using std::vector;
+using Eigen::Vector3f;
+
+// Grid cells across the longer side of the sketch
+const GLuint HEIGHTFIELD_RESOLUTION = 192;
+
+class HeightField
+{
+public:
+    Grid2D grid;                // raster layout
+    vector<GLfloat> power;      // d (2R - d) per node, negative outside
+
+    HeightField(void) {}
+
+    /**
+     * build
+     * Rasterizes the closed outline and computes the squared heights.
+     * @return GLboolean - GL_FALSE if the outline covers no pixel
+     */
+    GLboolean build(const vector<Vector3f> &outline, GLuint resolution,
+        ThreadPool *pool);
+
+    /**
+     * extract
+     * Replaces verts and faces with the front and back height meshes,
+     * stitched along the silhouette where the height falls to zero, and
+     * silhouette with those shared vertices in ascending order.
+     */
+    void extract(vector<Vector3f> &verts, vector<Triangle> &faces,
+        vector<GLuint> &silhouette, ThreadPool *pool);
+
+    void clear(void);
+
+private:
+    vector<unsigned char> inside;
+    vector<GLfloat> dist;
+
+    // Vertex of every inside node (front; back is the next one) and of
+    // every silhouette crossing on the right, up and diagonal edges
+    vector<GLint> node_vertex, right_vertex, up_vertex, diag_vertex;
+
+    // Per-row counts, then starting offsets
+    vector<GLuint> row_vertices, row_faces;
+
+    GLuint countRow(GLuint j) const;
+    void fillRow(GLuint j, vector<Vector3f> &verts);
+    GLuint cellFaces(GLuint j, Triangle *out) const;
+    Vector3f crossing(GLuint a, GLuint b) const;
+};
+
+#endif
@@ -0,0 +1,261 @@
+#include "implicit.h"
+
+#include <algorithm>
+#include <cmath>
+
+/**
+ * forBlocks
+ * Runs body over [0, n) one block at a time, on the pool when given.
+ */
+template <class F>
+static void forBlocks(ThreadPool *pool, GLuint n, F body)
+{
+    auto slice = [&](GLuint begin, GLuint end) {
+        for (GLuint i = begin; i < end; i++) body(i);
+    };
+    if (pool) pool->parallelFor(0, n, 1, slice);
+    else      slice(0, n);
+}
+
+void ImplicitSurface::clear(void)
+{
+    power.clear();
+    nz = 0;
+    active = 0;
+}
+
+GLboolean ImplicitSurface::build(const vector<Vector3f> &outline,
+    GLuint resolution, ThreadPool *pool)
+{
+    clear();
+    if (outline.size() < 3) return GL_FALSE;
+
+    grid.fit(outline, resolution, 2);
+    rasterizeOutline(outline, grid, inside);
+    insideDistance(inside, grid.nx, grid.ny, dist, pool);
+
+    GLfloat peak = medialPower(inside, dist, grid.nx, grid.ny, power, pool);
+    if (peak <= 0.0f) {
+        clear();
+        return GL_FALSE;
+    }
+
+    // Enough z nodes to leave two empty cells above and below the top
+    GLuint half = (GLuint)ceil(sqrtf(peak)) + 2;
+    nz = 2 * half + 1;
+    zc = half;
+    return GL_TRUE;
+}
+
+/**
+ * findBlocks
+ * Collects the blocks whose field bounds straddle zero. P bounds come from
+ * the block's xy tile, z^2 bounds from its z range.
+ */
+void ImplicitSurface::findBlocks(void)
+{
+    const GLuint B = IMPLICIT_BLOCK;
+    GLuint tx, ty, i, j;
+
+    cx = grid.nx - 1; cy = grid.ny - 1; cz = nz - 1;
+    bx = (cx + B - 1) / B; by = (cy + B - 1) / B; bz = (cz + B - 1) / B;
+
+    tile_min.assign(bx * by, DT_INFINITY);
+    tile_max.assign(bx * by, -DT_INFINITY);
+    for (ty = 0; ty < by; ty++) {
+        for (tx = 0; tx < bx; tx++) {
+            GLuint t = ty * bx + tx;
+            for (j = ty * B; j <= std::min(ty * B + B, cy); j++) {
+                for (i = tx * B; i <= std::min(tx * B + B, cx); i++) {
+                    GLfloat p = power[j * grid.nx + i];
+                    tile_min[t] = std::min(tile_min[t], p);
+                    tile_max[t] = std::max(tile_max[t], p);
+                }
+            }
+        }
+    }
+
+    active = 0;
+    block_map.assign(bx * by * bz, -1);
+    for (GLuint z = 0; z < bz; z++) {
+        GLfloat k0 = (GLfloat)(z * B) - zc, k1 = (GLfloat)std::min(z * B + B, cz) - zc;
+        GLfloat z2min = (k0 <= 0.0f && k1 >= 0.0f) ? 0.0f : std::min(k0 * k0, k1 * k1);
+        GLfloat z2max = std::max(k0 * k0, k1 * k1);
+
+        for (ty = 0; ty < by; ty++) {
+            for (tx = 0; tx < bx; tx++) {
+                GLuint t = ty * bx + tx;
+                if (tile_max[t] - z2min <= 0.0f || tile_min[t] - z2max > 0.0f)
+                    continue;
+
+                if (active == blocks.size()) blocks.push_back(Block());
+                Block &b = blocks[active];
+                b.bx = tx; b.by = ty; b.bz = z;
+                b.cell_vertex.assign(B * B * B, -1);
+                b.verts.clear();
+                b.faces.clear();
+                b.silhouette.clear();
+                block_map[(z * by + ty) * bx + tx] = active++;
+            }
+        }
+    }
+}
+
+/**
+ * placeVertices
+ * Puts one vertex in every cell of b that the surface crosses, at the mean
+ * of the crossings on the cell's edges. The z = 0 plane runs along grid
+ * nodes, so the cells just above and below it hold the silhouette.
+ */
+void ImplicitSurface::placeVertices(Block &b) const
+{
+    const GLuint B = IMPLICIT_BLOCK;
+    static const GLuint edges[12][2] = {
+        {0, 1}, {2, 3}, {4, 5}, {6, 7},     // along x
+        {0, 2}, {1, 3}, {4, 6}, {5, 7},     // along y
+        {0, 4}, {1, 5}, {2, 6}, {3, 7}      // along z
+    };
+
+    for (GLuint lk = 0; lk < B; lk++) {
+        GLuint k = b.bz * B + lk;
+        if (k >= cz) break;
+        GLboolean rim = (k + 1 == (GLuint)zc || k == (GLuint)zc);
+        for (GLuint lj = 0; lj < B; lj++) {
+            GLuint j = b.by * B + lj;
+            if (j >= cy) break;
+            for (GLuint li = 0; li < B; li++) {
+                GLuint i = b.bx * B + li;
+                if (i >= cx) break;
+
+                // Corner c is offset by (c & 1, c >> 1 & 1, c >> 2)
+                GLfloat f[8];
+                GLuint mask = 0;
+                for (GLuint c = 0; c < 8; c++) {
+                    f[c] = value(i + (c & 1), j + (c >> 1 & 1), k + (c >> 2));
+                    mask |= (f[c] > 0.0f) << c;
+                }
+                if (mask == 0 || mask == 255) continue;
+
+                Vector3f sum(0.0f, 0.0f, 0.0f);
+                GLuint n = 0;
+                for (GLuint e = 0; e < 12; e++) {
+                    GLuint c0 = edges[e][0], c1 = edges[e][1];
+                    if ((f[c0] > 0.0f) == (f[c1] > 0.0f)) continue;
+
+                    GLfloat t = f[c0] / (f[c0] - f[c1]);
+                    Vector3f p0(c0 & 1, c0 >> 1 & 1, c0 >> 2);
+                    Vector3f p1(c1 & 1, c1 >> 1 & 1, c1 >> 2);
+                    sum += p0 + t * (p1 - p0);
+                    n++;
+                }
+                sum /= n;
+
+                if (rim) b.silhouette.push_back(b.verts.size());
+                b.cell_vertex[(lk * B + lj) * B + li] = b.verts.size();
+                b.verts.push_back(Vector3f(
+                    grid.origin.x() + (i + sum.x()) * grid.cell,
+                    grid.origin.y() + (j + sum.y()) * grid.cell,
+                    (k + sum.z() - zc) * grid.cell));
+            }
+        }
+    }
+}
+
+GLint ImplicitSurface::cellVertex(GLint i, GLint j, GLint k) const
+{
+    const GLint B = IMPLICIT_BLOCK;
+    if (i < 0 || j < 0 || k < 0) return -1;
+
+    GLint m = block_map[((k / B) * by + j / B) * bx + i / B];
+    if (m < 0) return -1;
+
+    const Block &b = blocks[m];
+    GLint v = b.cell_vertex[((k % B) * B + j % B) * B + i % B];
+    return (v < 0) ? -1 : (GLint)b.vertex_base + v;
+}
+
+/**
+ * emitFaces
+ * Every cell owns the three grid edges leaving its lowest corner. An edge
+ * the surface crosses gets a quad joining the four cells around it, wound
+ * so its normal points from the inside corner to the outside one.
+ */
+void ImplicitSurface::emitFaces(Block &b) const
+{
+    const GLuint B = IMPLICIT_BLOCK;
+
+    for (GLuint lk = 0; lk < B; lk++) {
+        for (GLuint lj = 0; lj < B; lj++) {
+            for (GLuint li = 0; li < B; li++) {
+                if (b.cell_vertex[(lk * B + lj) * B + li] < 0) continue;
+
+                GLint n0[3] = { (GLint)(b.bx * B + li), (GLint)(b.by * B + lj), (GLint)(b.bz * B + lk) };
+                GLboolean in0 = value(n0[0], n0[1], n0[2]) > 0.0f;
+
+                for (GLuint a = 0; a < 3; a++) {
+                    GLint n1[3] = { n0[0], n0[1], n0[2] };
+                    n1[a]++;
+                    if ((value(n1[0], n1[1], n1[2]) > 0.0f) == in0) continue;
+
+                    // b x c = a, so c00 c10 c11 c01 turn counterclockwise
+                    // seen from +a
+                    GLuint ab = (a + 1) % 3, ac = (a + 2) % 3;
+                    GLint p[3] = { n0[0], n0[1], n0[2] };
+                    GLint c00 = cellVertex(p[0], p[1], p[2]);
+                    p[ab]--;
+                    GLint c10 = cellVertex(p[0], p[1], p[2]);
+                    p[ac]--;
+                    GLint c11 = cellVertex(p[0], p[1], p[2]);
+                    p[ab]++;
+                    GLint c01 = cellVertex(p[0], p[1], p[2]);
+                    if (c10 < 0 || c11 < 0 || c01 < 0) continue;
+
+                    if (in0) {
+                        b.faces.push_back(Triangle(c00, c10, c11));
+                        b.faces.push_back(Triangle(c00, c11, c01));
+                    } else {
+                        b.faces.push_back(Triangle(c00, c11, c10));
+                        b.faces.push_back(Triangle(c00, c01, c11));
+                    }
+                }
+            }
+        }
+    }
+}
+
+void ImplicitSurface::polygonize(vector<Vector3f> &verts,
+    vector<Triangle> &faces, vector<GLuint> &silhouette, ThreadPool *pool)
+{
+    GLuint m, nv = 0, nf = 0;
+
+    verts.clear();
+    faces.clear();
+    silhouette.clear();
+    if (nz == 0) return;
+
+    findBlocks();
+    forBlocks(pool, active, [this](GLuint m) { placeVertices(blocks[m]); });
+
+    // Blocks number their vertices in block order, so the output does not
+    // depend on which thread ran which block
+    for (m = 0; m < active; m++) {
+        blocks[m].vertex_base = nv;
+        nv += blocks[m].verts.size();
+    }
+    forBlocks(pool, active, [this](GLuint m) { emitFaces(blocks[m]); });
+    for (m = 0; m < active; m++) {
+        blocks[m].face_base = nf;
+        nf += blocks[m].faces.size();
+    }
+
+    verts.resize(nv);
+    faces.resize(nf);
+    forBlocks(pool, active, [&](GLuint m) {
+        const Block &b = blocks[m];
+        std::copy(b.verts.begin(), b.verts.end(), verts.begin() + b.vertex_base);
+        std::copy(b.faces.begin(), b.faces.end(), faces.begin() + b.face_base);
+    });
+    for (m = 0; m < active; m++)
+        for (GLuint k = 0; k < blocks[m].silhouette.size(); k++)
+            silhouette.push_back(blocks[m].vertex_base + blocks[m].silhouette[k]);
+}
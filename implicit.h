@@ -0,0 +1,102 @@
+/**
+ * implicit.h
+ * This file contains the ImplicitSurface class, an inflation engine that
+ * does not need a spine. Every inside point q of the outline carries the
+ * ball of radius d(q), its distance to the outline, and the solid is the
+ * union of those balls. Its field is the power distance
+ *
+ *     F(p) = max over q of d(q)^2 - |p - q|^2,
+ *
+ * positive inside. F splits into a 2D part P(x, y), found with the
+ * separable distance transform, minus z^2. Surface Nets polygonizes it over
+ * a block-sparse grid: only 8^3 blocks whose bounds straddle zero are
+ * visited, and blocks are processed in parallel.
+ */
+
+#ifndef _IMPLICIT_H_
+#define _IMPLICIT_H_
+
+#ifdef __APPLE__
+#include <OpenGL/gl.h>
+#else
+#include <GL/gl.h>
+#endif
+
+#include <vector>
+#include <Eigen/Core>
+#include "mesh.h"
+#include "distancefield.h"
+#include "threadpool.h"
+
+using std::vector;
+using Eigen::Vector3f;
+
+// Grid cells across the longer side of the sketch
+const GLuint IMPLICIT_RESOLUTION = 128;
+
+// Cells per block side
+const GLuint IMPLICIT_BLOCK = 8;
+
+class ImplicitSurface
+{
+public:
+    Grid2D grid;                // xy layout of the field
+    vector<GLfloat> power;      // P per xy node, in cells^2
+    GLuint nz;                  // z nodes, centered on z = 0
+
+    ImplicitSurface(void) : nz(0), zc(0.0f), active(0) {}
+
+    /**
+     * build
+     * Samples the field of the closed outline on a grid with about
+     * resolution cells across its longer side.
+     * @return GLboolean - GL_FALSE if the outline encloses no grid node
+     */
+    GLboolean build(const vector<Vector3f> &outline, GLuint resolution,
+        ThreadPool *pool);
+
+    /**
+     * polygonize
+     * Replaces verts and faces with the Surface Nets mesh of F = 0, in
+     * sketch coordinates and wound outward. The silhouette is the vertices
+     * of the cells bordering z = 0, in ascending order.
+     */
+    void polygonize(vector<Vector3f> &verts, vector<Triangle> &faces,
+        vector<GLuint> &silhouette, ThreadPool *pool);
+
+    void clear(void);
+
+    /**
+     * value
+     * F at grid node (i, j, k).
+     */
+    GLfloat value(GLuint i, GLuint j, GLuint k) const
+        { GLfloat z = (GLfloat)k - zc; return power[j * grid.nx + i] - z * z; }
+
+private:
+    struct Block {
+        GLuint bx, by, bz;
+        GLuint vertex_base, face_base;
+        vector<GLint>    cell_vertex;   // local vertex per cell or -1
+        vector<Vector3f> verts;
+        vector<Triangle> faces;
+        vector<GLuint>   silhouette;    // local vertices next to z = 0
+    };
+
+    GLfloat zc;                         // z node at height 0
+    GLuint  cx, cy, cz;                 // cells per axis
+    GLuint  bx, by, bz;                 // blocks per axis
+    vector<GLfloat> tile_min, tile_max; // P bounds per xy block, borders included
+    vector<GLint>   block_map;          // active block index or -1
+    vector<Block>   blocks;             // storage outlives the active count
+    GLuint          active;             // blocks in use
+    vector<unsigned char> inside;       // raster scratch
+    vector<GLfloat> dist;
+
+    void findBlocks(void);
+    void placeVertices(Block &b) const;
+    void emitFaces(Block &b) const;
+    GLint cellVertex(GLint i, GLint j, GLint k) const;
+};
+
+#endif
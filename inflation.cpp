@@ -0,0 +1,399 @@
+#include "inflation.h"
+
+#include <cmath>
+#include <utility>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define INFLATE_SSE
+#endif
+
+static constexpr GLdouble TWO_PI = 6.283185307179586476925286766559005768394;
+
+static_assert(sizeof(Vector3f) == 3 * sizeof(GLfloat),
+    "the kernels write packed xyz through Vector3f storage");
+
+void UnitCircle::resize(GLuint n)
+{
+    GLuint padded = (n + 3) & ~3u;
+
+    segments = n;
+    sines.assign(padded, 0.0f);
+    cosines.assign(padded, 0.0f);
+    for (GLuint j = 0; j < n; j++) {
+        sines[j]   = sin(TWO_PI * j / n);
+        cosines[j] = cos(TWO_PI * j / n);
+    }
+}
+
+void orientRings(vector<Ring> &rings, const Tube &tube)
+{
+    GLuint first = tube.ring, last = tube.ring + tube.rings - 1;
+
+    for (GLuint k = first; k <= last; k++) {
+        Vector2f prev = (k == first) ? tube.head.head<2>() : rings[k - 1].center;
+        Vector2f next = (k == last)  ? tube.tail.head<2>() : rings[k + 1].center;
+        Vector2f t = next - prev;
+        Vector2f &a = rings[k].axis;
+
+        // Junction rings have no chord, so use the tube's cross direction
+        if (a.squaredNorm() == 0.0f) {
+            a = Vector2f(t.y(), -t.x());
+            if (a.squaredNorm() == 0.0f) a = Vector2f(1.0f, 0.0f);
+            a.normalize();
+        } else if (a.x() * t.y() - a.y() * t.x() < 0.0f) {
+            a = -a;
+        }
+    }
+}
+
+/**
+ * spinePole
+ * Pole position past spine node n, leaving in direction d. Pruned tips use
+ * their farthest attached outline vertex; other nodes use their center.
+ */
+static Vector3f spinePole(const Spine &spine, const Triangulation &tri,
+    GLint n, const Vector2f &d)
+{
+    Vector2f c = spine.nodes[n], best = c + d * spine.radius[n];
+    GLfloat reach = 0.0f;
+
+    if (spine.kinds[n] != SPINE_END)
+        return Vector3f(c.x(), c.y(), 0.0f);
+
+    for (GLint k = spine.fan_offsets[n]; k < spine.fan_offsets[n + 1]; k++) {
+        const Vector2f &p = tri.points[spine.fan[k]];
+        GLfloat along = (p - c).dot(d);
+        if (along > reach) {
+            reach = along;
+            best  = p;
+        }
+    }
+    return Vector3f(best.x(), best.y(), 0.0f);
+}
+
+void buildSpineTubes(const Spine &spine, const Triangulation &tri,
+    vector<Ring> &rings, vector<Tube> &tubes)
+{
+    for (GLuint c = 0; c < spine.numChains(); c++) {
+        GLint first = spine.chain_offsets[c], last = spine.chain_offsets[c + 1] - 1;
+        GLint n0 = spine.chains[first], n1 = spine.chains[last];
+        Tube tube;
+        Vector2f d;
+
+        tube.ring  = rings.size();
+        tube.rings = last - first + 1;
+        for (GLint k = first; k <= last; k++) {
+            GLint n = spine.chains[k];
+            rings.push_back(Ring(spine.nodes[n], spine.radius[n], spine.chords[n]));
+        }
+
+        if (first == last) {
+            // Lone node: close the ring across its chord
+            Vector2f a = spine.chords[n0];
+            d = (a.squaredNorm() > 0.0f) ? Vector2f(-a.y(), a.x()) : Vector2f(1.0f, 0.0f);
+            tube.head = spinePole(spine, tri, n0, -d);
+            tube.tail = spinePole(spine, tri, n0, d);
+        } else {
+            d = (spine.nodes[n0] - spine.nodes[spine.chains[first + 1]]).normalized();
+            tube.head = spinePole(spine, tri, n0, d);
+            d = (spine.nodes[n1] - spine.nodes[spine.chains[last - 1]]).normalized();
+            tube.tail = spinePole(spine, tri, n1, d);
+        }
+
+        orientRings(rings, tube);
+        tubes.push_back(tube);
+    }
+}
+
+CircleCache::CircleCache(void)
+    :circles(MAX_RING_SEGMENTS / 4 + 1)
+{
+    for (GLuint k = 1; k < circles.size(); k++)
+        circles[k].resize(4 * k);
+}
+
+GLuint ringSegments(GLfloat radius, GLfloat tolerance, GLuint max_segments)
+{
+    GLdouble n = MIN_RING_SEGMENTS;
+
+    if (tolerance < radius)
+        n = ceil(TWO_PI / 2 / acos(1.0 - tolerance / radius));
+    if (n > max_segments) return max_segments;
+    if (n < MIN_RING_SEGMENTS) return MIN_RING_SEGMENTS;
+    return ((GLuint)n + 3) & ~3u;
+}
+
+void tessellateRings(vector<Ring> &rings, GLfloat tolerance, GLuint max_segments)
+{
+    if (max_segments > MAX_RING_SEGMENTS) max_segments = MAX_RING_SEGMENTS;
+
+    for (GLuint k = 0; k < rings.size(); k++)
+        rings[k].segments = (tolerance > 0.0f) ?
+            ringSegments(rings[k].radius, tolerance, max_segments) : max_segments;
+}
+
+GLuint layoutTubes(vector<Tube> &tubes, vector<Ring> &rings)
+{
+    GLuint count = 0;
+
+    for (GLuint i = 0; i < tubes.size(); i++) {
+        tubes[i].base = count++;
+        for (GLuint k = tubes[i].ring; k < tubes[i].ring + tubes[i].rings; k++) {
+            rings[k].offset = count;
+            count += rings[k].segments;
+        }
+        count++;
+    }
+    return count;
+}
+
+Triangle *stitchRings(const Ring &a, const Ring &b, Triangle *out)
+{
+    const GLuint na = a.segments, nb = b.segments;
+    GLuint i = 0, j = 0;
+
+    // Advance whichever ring's next sample comes first in angle; ties step
+    // b first, which reproduces the quad split of equal rings.
+    while (i < na || j < nb) {
+        GLuint ai = a.offset + i % na, bj = b.offset + j % nb;
+
+        if (j == nb || (i < na && (i + 1) * nb < (j + 1) * na)) {
+            *out++ = Triangle(ai, a.offset + (i + 1) % na, bj);
+            i++;
+        } else {
+            *out++ = Triangle(ai, b.offset + (j + 1) % nb, bj);
+            j++;
+        }
+    }
+    return out;
+}
+
+Triangle *capRing(const Ring &r, GLuint pole, GLboolean reverse, Triangle *out)
+{
+    for (GLuint j = 0; j < r.segments; j++) {
+        GLuint p0 = r.offset + j;
+        GLuint p1 = r.offset + (j + 1) % r.segments;
+
+        *out++ = reverse ? Triangle(pole, p0, p1) : Triangle(pole, p1, p0);
+    }
+    return out;
+}
+
+/**
+ * RingBasis struct
+ * Per-ring constants of the inflation kernels. Vertex j of a ring is
+ * center + r sin(theta_j) axis + r cos(theta_j) z.
+ */
+struct RingBasis {
+    GLfloat cx, cy, ax, ay, r;
+#ifdef INFLATE_SSE
+    __m128 vcx, vcy, vax, vay, vr;
+#endif
+
+    RingBasis(const Ring &ring)
+        :cx(ring.center.x()), cy(ring.center.y()),
+         ax(ring.radius * ring.axis.x()), ay(ring.radius * ring.axis.y()),
+         r(ring.radius)
+    {
+#ifdef INFLATE_SSE
+        vcx = _mm_set1_ps(cx); vcy = _mm_set1_ps(cy);
+        vax = _mm_set1_ps(ax); vay = _mm_set1_ps(ay);
+        vr  = _mm_set1_ps(r);
+#endif
+    }
+};
+
+static inline void ringSample(const RingBasis &b, GLfloat s, GLfloat c,
+    GLfloat *out)
+{
+    out[0] = b.cx + b.ax * s;
+    out[1] = b.cy + b.ay * s;
+    out[2] = b.r * c;
+}
+
+/**
+ * ringBlock
+ * Evaluates four consecutive samples. The SSE path interleaves them into
+ * packed xyz with shuffles, so the three stores stay contiguous.
+ */
+static inline void ringBlock(const RingBasis &b, const GLfloat *s,
+    const GLfloat *c, GLfloat *out)
+{
+#ifdef INFLATE_SSE
+    __m128 S = _mm_loadu_ps(s), C = _mm_loadu_ps(c);
+    __m128 X = _mm_add_ps(b.vcx, _mm_mul_ps(b.vax, S));
+    __m128 Y = _mm_add_ps(b.vcy, _mm_mul_ps(b.vay, S));
+    __m128 Z = _mm_mul_ps(b.vr, C);
+
+    __m128 xy01 = _mm_unpacklo_ps(X, Y);                         // x0 y0 x1 y1
+    __m128 xy23 = _mm_unpackhi_ps(X, Y);                         // x2 y2 x3 y3
+    __m128 zx01 = _mm_shuffle_ps(Z, X, _MM_SHUFFLE(1, 1, 0, 0)); // z0 z0 x1 x1
+    __m128 yz11 = _mm_shuffle_ps(Y, Z, _MM_SHUFFLE(1, 1, 1, 1)); // y1 y1 z1 z1
+    __m128 zx23 = _mm_shuffle_ps(Z, X, _MM_SHUFFLE(3, 3, 2, 2)); // z2 z2 x3 x3
+    __m128 yz33 = _mm_shuffle_ps(Y, Z, _MM_SHUFFLE(3, 3, 3, 3)); // y3 y3 z3 z3
+
+    _mm_storeu_ps(out,     _mm_shuffle_ps(xy01, zx01, _MM_SHUFFLE(2, 0, 1, 0)));
+    _mm_storeu_ps(out + 4, _mm_shuffle_ps(yz11, xy23, _MM_SHUFFLE(1, 0, 2, 0)));
+    _mm_storeu_ps(out + 8, _mm_shuffle_ps(zx23, yz33, _MM_SHUFFLE(2, 0, 2, 0)));
+#else
+    for (GLuint k = 0; k < 4; k++)
+        ringSample(b, s[k], c[k], out + 3 * k);
+#endif
+}
+
+/**
+ * inflateRing
+ * Table-driven kernel for segment counts without a specialization.
+ */
+static inline void inflateRing(const Ring &ring, const UnitCircle &circle,
+    GLfloat *out)
+{
+    const RingBasis b(ring);
+    const GLfloat *s = &circle.sines[0], *c = &circle.cosines[0];
+    const GLuint n = circle.segments;
+    GLuint j = 0;
+
+    for (; j + 4 <= n; j += 4, out += 12)
+        ringBlock(b, s + j, c + j, out);
+    for (; j < n; j++, out += 3)
+        ringSample(b, s[j], c[j], out);
+}
+
+/********* SPECIALIZED KERNELS *********/
+
+/**
+ * ctSin & ctCos
+ * Compile-time sine and cosine by range reduction and Taylor series.
+ */
+static constexpr GLdouble ctSin(GLdouble x)
+{
+    const GLdouble pi = TWO_PI / 2;
+    while (x > pi)  x -= TWO_PI;
+    while (x < -pi) x += TWO_PI;
+
+    GLdouble term = x, sum = x;
+    for (GLint k = 1; k < 16; k++) {
+        term *= -x * x / ((2 * k) * (2 * k + 1));
+        sum  += term;
+    }
+    return sum;
+}
+
+static constexpr GLdouble ctCos(GLdouble x)
+{
+    return ctSin(x + TWO_PI / 4);
+}
+
+/**
+ * RingTable struct
+ * Unit circle for N segments, evaluated entirely at compile time.
+ */
+template <GLuint N>
+struct RingTable {
+    alignas(16) GLfloat sines[N];
+    alignas(16) GLfloat cosines[N];
+
+    constexpr RingTable(void) : sines(), cosines()
+    {
+        for (GLuint j = 0; j < N; j++) {
+            sines[j]   = ctSin(TWO_PI * j / N);
+            cosines[j] = ctCos(TWO_PI * j / N);
+        }
+    }
+};
+
+template <GLuint N>
+static constexpr RingTable<N> ring_table;
+
+/**
+ * inflateRingN
+ * One ring with N segments; the fold over B unrolls all N/4 blocks.
+ */
+template <GLuint N, std::size_t... B>
+static inline void inflateRingN(const RingBasis &b, GLfloat *out,
+    std::index_sequence<B...>)
+{
+    (ringBlock(b, ring_table<N>.sines + 4 * B, ring_table<N>.cosines + 4 * B,
+               out + 12 * B), ...);
+}
+
+template <GLuint N>
+static void inflateRingsN(const Ring *rings, GLuint count, GLfloat *out)
+{
+    static_assert(N % 4 == 0, "specialized rings need a multiple of 4 segments");
+
+    for (GLuint k = 0; k < count; k++, out += 3 * N)
+        inflateRingN<N>(RingBasis(rings[k]), out, std::make_index_sequence<N / 4>());
+}
+
+void inflateRings(const Ring *rings, GLuint count, const CircleCache &circles,
+    GLfloat *out)
+{
+    GLuint k = 0;
+
+    while (k < count) {
+        const GLuint n = rings[k].segments;
+        GLuint run = 1;
+
+        while (k + run < count && rings[k + run].segments == n) run++;
+
+        switch (n) {
+        case 12:  inflateRingsN<12>(rings + k, run, out);  break;
+        case 24:  inflateRingsN<24>(rings + k, run, out);  break;
+        case 60:  inflateRingsN<60>(rings + k, run, out);  break;
+        case 120: inflateRingsN<120>(rings + k, run, out); break;
+        default:
+            for (GLuint r = 0; r < run; r++)
+                inflateRing(rings[k + r], circles.circle(n), out + 3 * n * r);
+        }
+        out += 3 * n * run;
+        k   += run;
+    }
+}
+
+/**
+ * inflateSpan
+ * Inflates rings [begin, end), splitting at tube boundaries where the
+ * pole vertices break the contiguous output.
+ */
+static void inflateSpan(const Ring *rings, GLuint begin, GLuint end,
+    const CircleCache &circles, Vector3f *verts)
+{
+    while (begin < end) {
+        GLuint stop = begin + 1;
+        while (stop < end &&
+               rings[stop].offset == rings[stop - 1].offset + rings[stop - 1].segments)
+            stop++;
+
+        inflateRings(rings + begin, stop - begin, circles, verts[rings[begin].offset].data());
+        begin = stop;
+    }
+}
+
+void inflateTubes(const vector<Ring> &rings, const vector<Tube> &tubes,
+    const CircleCache &circles, vector<Vector3f> &verts, ThreadPool *pool)
+{
+    for (GLuint i = 0; i < tubes.size(); i++) {
+        const Tube &t = tubes[i];
+        const Ring &last = rings[t.ring + t.rings - 1];
+
+        verts[t.base] = t.head;
+        verts[last.offset + last.segments] = t.tail;
+    }
+    if (rings.empty()) return;
+
+    // Ring offsets are the prefix sum from layoutTubes, so slices are
+    // independent; size them by the mean ring to balance vertex counts
+    GLuint n = rings.size();
+    GLuint mean = (verts.size() + n - 1) / n;
+    GLuint grain = (INFLATE_GRAIN + mean - 1) / mean;
+
+    if (!pool || pool->size() < 2 || verts.size() < 2 * INFLATE_GRAIN) {
+        inflateSpan(&rings[0], 0, n, circles, &verts[0]);
+        return;
+    }
+    pool->parallelFor(0, n, grain, [&](GLuint begin, GLuint end) {
+        inflateSpan(&rings[0], begin, end, circles, &verts[0]);
+    });
+}
@@ -0,0 +1,188 @@
+/**
+ * inflation.h
+ * This file contains the batched inflation kernel, which turns per-ring
+ * parameters (center, radius, chord direction) into ring vertices, and the
+ * helpers that derive those rings from the spine graph.
+ */
+
+#ifndef _INFLATION_H_
+#define _INFLATION_H_
+
+#ifdef __APPLE__
+#include <OpenGL/gl.h>
+#else
+#include <GL/gl.h>
+#endif
+
+#include <vector>
+#include <Eigen/Core>
+#include "mesh.h"
+#include "spine.h"
+#include "threadpool.h"
+#include "triangulation.h"
+
+using std::vector;
+using Eigen::Vector2f;
+using Eigen::Vector3f;
+
+/**
+ * Ring struct
+ * A circle of the inflated surface. It is centred on a spine point and lies
+ * in the plane spanned by the unit chord direction (axis) and the z axis.
+ * Each ring carries its own segment count and first vertex index, so rings
+ * of one tube may be tessellated differently.
+ */
+struct Ring {
+    Vector2f center;
+    GLfloat  radius;
+    Vector2f axis;
+    GLuint   segments;  // vertices on the ring, a multiple of 4
+    GLuint   offset;    // index of the ring's first vertex
+
+    Ring(void)
+        :center(0.0f, 0.0f), radius(0.0f), axis(1.0f, 0.0f),
+         segments(0), offset(0) {}
+    Ring(const Vector2f &c, GLfloat r, const Vector2f &a)
+        :center(c), radius(r), axis(a), segments(0), offset(0) {}
+};
+
+/**
+ * Tube struct
+ * A run of consecutive rings closed by a pole vertex at each end. Vertices
+ * are laid out as [head pole, ring 0, ..., ring n-1, tail pole] from base.
+ */
+struct Tube {
+    GLuint   ring;      // first ring of the tube
+    GLuint   rings;     // number of rings
+    GLuint   base;      // vertex index of the head pole
+    Vector3f head, tail;
+
+    Tube(void)
+        :ring(0), rings(0), base(0), head(0, 0, 0), tail(0, 0, 0) {}
+};
+
+/**
+ * Ring resolutions with compile-time specialized kernels, used as quality
+ * presets. Any other segment count runs through the table-driven kernel.
+ */
+const GLuint RING_PRESETS[] = { 12, 24, 60, 120 };
+const GLuint NUM_RING_PRESETS = sizeof(RING_PRESETS) / sizeof(RING_PRESETS[0]);
+
+// Vertices per parallel inflation slice, and the least worth splitting
+const GLuint INFLATE_GRAIN = 8192;
+
+// Bounds on adaptive segment counts
+const GLuint MIN_RING_SEGMENTS = 8;
+const GLuint MAX_RING_SEGMENTS = 256;
+
+/**
+ * UnitCircle class
+ * Sine and cosine of every angular sample, padded to a multiple of 4.
+ */
+class UnitCircle
+{
+public:
+    vector<GLfloat> sines, cosines;
+    GLuint segments;
+
+    UnitCircle(void) : segments(0) {}
+    UnitCircle(GLuint n) : segments(0) { resize(n); }
+
+    void resize(GLuint n);
+};
+
+/**
+ * CircleCache class
+ * One UnitCircle for every multiple of 4 up to MAX_RING_SEGMENTS, built up
+ * front so inflation never allocates or calls sin/cos.
+ */
+class CircleCache
+{
+public:
+    CircleCache(void);
+
+    const UnitCircle &circle(GLuint segments) const
+        { return circles[segments / 4]; }
+
+private:
+    vector<UnitCircle> circles;     // circles[k] has 4k segments
+};
+
+/**
+ * ringSegments
+ * Fewest segments, rounded up to a multiple of 4, for which a ring of the
+ * given radius deviates from the true circle by at most tolerance. The
+ * sagitta r (1 - cos(pi / n)) is the chord error of an n-gon.
+ * @return GLuint - clamped to [MIN_RING_SEGMENTS, max_segments]
+ */
+GLuint ringSegments(GLfloat radius, GLfloat tolerance, GLuint max_segments);
+
+/**
+ * tessellateRings
+ * Picks every ring's segment count. A tolerance <= 0 gives all rings
+ * max_segments.
+ */
+void tessellateRings(vector<Ring> &rings, GLfloat tolerance, GLuint max_segments);
+
+/**
+ * orientRings
+ * Flips ring axes so every ring's first quarter turns the same way around
+ * the tube. This keeps face winding outward-facing regardless of the
+ * direction the stroke was drawn in.
+ */
+void orientRings(vector<Ring> &rings, const Tube &tube);
+
+/**
+ * buildSpineTubes
+ * Appends one tube per spine chain. Chain ends at pruned tips get a pole
+ * at the farthest attached outline vertex; ends at junctions close on the
+ * junction center, inside the neighboring tubes.
+ */
+void buildSpineTubes(const Spine &spine, const Triangulation &tri,
+    vector<Ring> &rings, vector<Tube> &tubes);
+
+/**
+ * layoutTubes
+ * Assigns every tube its vertex range and every ring its first vertex.
+ * @return GLuint - total number of vertices the tubes need
+ */
+GLuint layoutTubes(vector<Tube> &tubes, vector<Ring> &rings);
+
+/**
+ * inflateRings
+ * Writes each ring's segments vertices, as packed xyz floats, to out. Runs
+ * of rings at a preset resolution dispatch to unrolled kernels with
+ * constexpr sin/cos tables.
+ */
+void inflateRings(const Ring *rings, GLuint count, const CircleCache &circles,
+    GLfloat *out);
+
+/**
+ * inflateTubes
+ * Fills verts, which must already hold layoutTubes() vertices, with the
+ * pole and ring vertices of every tube. Given a pool, large meshes are
+ * filled by slices of rings in parallel. Each ring writes only its own
+ * range, so the result is bit-identical to the serial fill.
+ */
+void inflateTubes(const vector<Ring> &rings, const vector<Tube> &tubes,
+    const CircleCache &circles, vector<Vector3f> &verts,
+    ThreadPool *pool = NULL);
+
+/**
+ * stitchRings
+ * Writes the band of triangles between consecutive rings a and b to out.
+ * Rings with different segment counts are zipped by angle, so the band has
+ * a.segments + b.segments faces and no T-junctions.
+ * @return Triangle* - one past the last face written
+ */
+Triangle *stitchRings(const Ring &a, const Ring &b, Triangle *out);
+
+/**
+ * capRing
+ * Writes a fan of r.segments faces closing ring r at pole; reverse picks
+ * the tail winding.
+ * @return Triangle* - one past the last face written
+ */
+Triangle *capRing(const Ring &r, GLuint pole, GLboolean reverse, Triangle *out);
+
+#endif
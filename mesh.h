@@ -1,7 +1,7 @@
 /**
  * mesh.h
- * This file contains a Mesh class that handles the construction and rendering
- * of a mesh given the vertex and triangle face data.
+ * This file contains the Triangle and Vertex types shared by the mesh
+ * builders, the mesh stages and the renderer.
  */
 
 #ifndef _MESH_H_
@@ -53,62 +53,4 @@ struct Vertex {
     Vector3f normal;
 };
 
-class Mesh
-{
-public:
-    // Mesh Data
-    vector<Vector3f> vertices;
-    vector<Triangle> tri_indices;
-
-    // Constructors
-    Mesh(void) {}
-    Mesh(vector<Vector3f> &vertices, vector<Triangle> &indices)
-    {
-        this->vertices    = vertices;
-        this->tri_indices = indices;
-    }
-
-    // Render mesh
-    void draw(void)
-    {
-        Vector3f v0, v1, v2, u, v;
-        GLuint i;
-        GLfloat weight = 1.0f;
-
-        glBegin(GL_TRIANGLES);
-        for (i = 0; i < tri_indices.size(); i++) {
-            // Get triangle vertices
-            v0 = vertices[ tri_indices[i].vertex1 ];
-            v1 = vertices[ tri_indices[i].vertex2 ];
-            v2 = vertices[ tri_indices[i].vertex3 ];
-
-            // Compute triangle surface normal
-            u = v1 - v0;
-            v = v2 - v0;
-            GLfloat nx = u.y() * v.z() - u.z() * v.y();
-            GLfloat ny = u.z() * v.x() - u.x() * v.z();
-            GLfloat nz = u.x() * v.y() - u.y() * v.x();
-
-            // Check if weight should be applied
-            GLfloat check = sqrt(v0(0)*v0(0) + v0(1)*v0(1) + v0(2)*v0(2));
-            if (check <= 1 )
-                weight = 200.0f;
-            else if (check <= 20)
-                weight = 50.0f;
-
-            // Apply weights
-            v0 *= weight; v1 *= weight; v2 *= weight;
-
-            glNormal3f(nx, ny, nz);
-            glVertex3f(v0.x(), v0.y(), v0.z());
-            glVertex3f(v1.x(), v1.y(), v1.z());
-            glVertex3f(v2.x(), v2.y(), v2.z());
-        }
-        glEnd();
-    }
-
-private:
-
-};
-
 #endif
@@ -0,0 +1,83 @@
+#include "meshbuilder.h"
+
+/**
+ * resize
+ * Resizes buffer, counting the times its storage had to grow.
+ */
+template <class T>
+void MeshBuilder::resize(vector<T> &buffer, GLuint n)
+{
+    if (n > buffer.capacity()) reallocations++;
+    buffer.resize(n);
+}
+
+void MeshBuilder::reset(void)
+{
+    rings.clear();
+    tubes.clear();
+    vertex_count = 0;
+}
+
+void MeshBuilder::reserve(GLuint ring_count, GLuint tube_count)
+{
+    if (ring_count > rings.capacity()) {
+        rings.reserve(ring_count);
+        reallocations++;
+    }
+    if (tube_count > tubes.capacity()) {
+        tubes.reserve(tube_count);
+        reallocations++;
+    }
+}
+
+void MeshBuilder::fromSpine(const Spine &spine, const Triangulation &tri)
+{
+    reset();
+    reserve(spine.chains.size(), spine.numChains());
+    buildSpineTubes(spine, tri, rings, tubes);
+}
+
+void MeshBuilder::buildVertices(GLfloat tolerance, GLuint max_segments,
+    const CircleCache &circles, vector<Vector3f> &verts, ThreadPool *pool)
+{
+    tessellateRings(rings, tolerance, max_segments);
+
+    GLuint count = layoutTubes(tubes, rings);
+    vertex_count = count - 2 * tubes.size();
+    resize(verts, count);
+    inflateTubes(rings, tubes, circles, verts, pool);
+}
+
+void MeshBuilder::buildFaces(vector<Triangle> &faces)
+{
+    resize(faces, 2 * vertex_count);
+
+    Triangle *out = faces.data();
+    for (GLuint i = 0; i < tubes.size(); i++) {
+        const Tube &t = tubes[i];
+        const Ring &first = rings[t.ring], &last = rings[t.ring + t.rings - 1];
+
+        for (GLuint k = t.ring; k + 1 < t.ring + t.rings; k++)
+            out = stitchRings(rings[k], rings[k + 1], out);
+
+        // Close both ends with a fan to the pole vertices
+        out = capRing(first, t.base, GL_FALSE, out);
+        out = capRing(last, last.offset + last.segments, GL_TRUE, out);
+    }
+}
+
+void MeshBuilder::buildSilhouette(vector<GLuint> &silhouette) const
+{
+    silhouette.clear();
+    for (GLuint i = 0; i < tubes.size(); i++) {
+        const Tube &t = tubes[i];
+        const Ring &last = rings[t.ring + t.rings - 1];
+
+        silhouette.push_back(t.base);
+        for (GLuint k = t.ring; k < t.ring + t.rings; k++) {
+            silhouette.push_back(rings[k].offset + rings[k].segments / 4);
+            silhouette.push_back(rings[k].offset + 3 * rings[k].segments / 4);
+        }
+        silhouette.push_back(last.offset + last.segments);
+    }
+}
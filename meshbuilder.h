@@ -0,0 +1,92 @@
+/**
+ * meshbuilder.h
+ * This file contains the MeshBuilder class, which owns the rings and tubes
+ * of the inflated mesh and turns them into vertex and face buffers. Every
+ * count is known before anything is written, so the buffers are sized once
+ * per regenerate with pole slots already in place. Storage is kept across
+ * sketches, so regenerating a mesh no larger than an earlier one never
+ * allocates.
+ */
+
+#ifndef _MESHBUILDER_H_
+#define _MESHBUILDER_H_
+
+#ifdef __APPLE__
+#include <OpenGL/gl.h>
+#else
+#include <GL/gl.h>
+#endif
+
+#include <vector>
+#include <Eigen/Core>
+#include "mesh.h"
+#include "inflation.h"
+#include "threadpool.h"
+
+using std::vector;
+using Eigen::Vector3f;
+
+class MeshBuilder
+{
+public:
+    vector<Ring> rings;
+    vector<Tube> tubes;
+
+    // Buffer growths since construction; flat once sketches stop growing
+    GLuint reallocations;
+
+    MeshBuilder(void) : reallocations(0), vertex_count(0) {}
+
+    /**
+     * reset
+     * Drops all rings and tubes, keeping their storage.
+     */
+    void reset(void);
+
+    /**
+     * reserve
+     * Makes room for at least the given number of rings and tubes.
+     */
+    void reserve(GLuint ring_count, GLuint tube_count);
+
+    /**
+     * fromSpine
+     * Replaces the rings and tubes with one tube per spine chain, reserving
+     * exactly the chains' node count first.
+     */
+    void fromSpine(const Spine &spine, const Triangulation &tri);
+
+    /**
+     * buildVertices
+     * Sizes every ring, lays the tubes out and inflates them into verts.
+     * A tolerance <= 0 gives every ring max_segments.
+     */
+    void buildVertices(GLfloat tolerance, GLuint max_segments,
+        const CircleCache &circles, vector<Vector3f> &verts, ThreadPool *pool);
+
+    /**
+     * buildFaces
+     * Writes the bands between rings and the pole caps into faces. Each
+     * ring vertex starts two faces, so faces holds exactly twice the ring
+     * vertices.
+     */
+    void buildFaces(vector<Triangle> &faces);
+
+    /**
+     * buildSilhouette
+     * Writes the vertices on the z = 0 plane in ascending order: the two
+     * samples a quarter turn from the start of every ring, and the poles.
+     */
+    void buildSilhouette(vector<GLuint> &silhouette) const;
+
+    GLboolean empty(void) const
+        { return tubes.empty(); }
+
+private:
+    GLuint vertex_count;    // ring vertices from the last buildVertices
+
+    template <class T>
+    void resize(vector<T> &buffer, GLuint n);
+};
+
+#endif
@@ -0,0 +1,143 @@
+#include "optimizer.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+typedef std::chrono::steady_clock Clock;
+
+/**
+ * factorize
+ * Builds the row-normalized uniform Laplacian L = I - D^-1 A from the
+ * neighbor rings and factorizes L^T L + I for the curvature solve and
+ * L^T L + W^2 for the position solve.
+ */
+void SurfaceOptimizer::factorize(void)
+{
+    GLuint n = vertex_count, i;
+
+    // Rings are symmetric, so column j holds j and its neighbors' rows
+    Eigen::VectorXi sizes(n);
+    for (i = 0; i < n; i++)
+        sizes[i] = adjacency.degree(i) + 1;
+    laplacian.resize(n, n);
+    laplacian.reserve(sizes);
+    for (i = 0; i < n; i++) {
+        GLboolean diagonal = GL_FALSE;
+        for (GLuint k = adjacency.ring_first[i]; k < adjacency.ring_first[i + 1]; k++) {
+            GLuint r = adjacency.ring[k];
+            if (r > i && !diagonal) {
+                laplacian.insert(i, i) = 1.0;
+                diagonal = GL_TRUE;
+            }
+            laplacian.insert(r, i) = -1.0 / adjacency.degree(r);
+        }
+        if (!diagonal) laplacian.insert(i, i) = 1.0;
+    }
+    laplacian.makeCompressed();
+    laplacian_t = laplacian.transpose();
+
+    SparseMatrix system = laplacian_t * laplacian;
+    SparseMatrix weights(n, n);
+    weights.reserve(Eigen::VectorXi::Constant(n, 1));
+    for (i = 0; i < n; i++)
+        weights.insert(i, i) = 1.0;
+
+    curvature_solver.compute(system + weights);
+    for (i = 0; i < n; i++)
+        weights.coeffRef(i, i) = anchor[i];
+    position_solver.compute(system + weights);
+    factorizations++;
+}
+
+void SurfaceOptimizer::begin(const vector<Vector3f> &verts,
+    const vector<Triangle> &mesh_faces, const vector<GLuint> &silhouette,
+    const Adjacency &mesh_adjacency)
+{
+    GLuint n = verts.size(), i;
+
+    iterations = 0;
+    converged = (n == 0 || mesh_faces.empty()) ? GL_TRUE : GL_FALSE;
+    if (converged) {
+        positions = verts;
+        return;
+    }
+
+    vector<double> weights(n, OPTIMIZE_ANCHOR * OPTIMIZE_ANCHOR);
+    for (i = 0; i < silhouette.size(); i++)
+        if (silhouette[i] < n) weights[silhouette[i]] = OPTIMIZE_PIN * OPTIMIZE_PIN;
+    tolerance = OPTIMIZE_TOLERANCE * meshExtent(verts);
+
+    // Same faces and anchors keep both factorizations and continue from
+    // the last solution; anything else starts over from verts
+    unsigned long long key = faceHash(n, mesh_faces);
+    if (n != vertex_count || key != topology || weights != anchor) {
+        vertex_count = n;
+        topology = key;
+        faces = mesh_faces;
+        adjacency = mesh_adjacency;
+        anchor.swap(weights);
+        positions = verts;
+        factorize();
+        if (curvature_solver.info() != Eigen::Success ||
+            position_solver.info() != Eigen::Success) {
+            vertex_count = 0;
+            converged = GL_TRUE;
+            return;
+        }
+    }
+
+    x.resize(n, 3);
+    anchored.resize(n, 3);
+    for (i = 0; i < n; i++) {
+        x.row(i) = positions[i].cast<double>().transpose();
+        anchored.row(i) = anchor[i] * verts[i].cast<double>().transpose();
+    }
+}
+
+/**
+ * iterate
+ * One curvature solve and one position solve from the current positions.
+ */
+void SurfaceOptimizer::iterate(void)
+{
+    GLuint n = vertex_count, i;
+
+    adjacency.vertexNormals(positions, faces, normals, NULL);
+
+    // Current Laplacian magnitudes, smoothed
+    Eigen::MatrixX3d lx = laplacian * x;
+    curvature.resize(n);
+    for (i = 0; i < n; i++)
+        curvature[i] = lx.row(i).dot(normals[i].cast<double>());
+    Eigen::VectorXd smooth = curvature_solver.solve(curvature);
+
+    delta.resize(n, 3);
+    for (i = 0; i < n; i++)
+        delta.row(i) = smooth[i] * normals[i].cast<double>().transpose();
+    // Evaluated first; the solver would redo the product per coefficient
+    rhs.noalias() = laplacian_t * delta;
+    rhs += anchored;
+    x = position_solver.solve(rhs);
+
+    GLfloat moved = 0.0f;
+    for (i = 0; i < n; i++) {
+        Vector3f p = x.row(i).transpose().cast<float>();
+        moved = std::max(moved, (p - positions[i]).norm());
+        positions[i] = p;
+    }
+    iterations++;
+    converged = (moved <= tolerance || iterations >= OPTIMIZE_MAX_ITERATIONS);
+}
+
+GLboolean SurfaceOptimizer::step(GLfloat budget)
+{
+    Clock::time_point start = Clock::now();
+
+    while (!converged) {
+        iterate();
+        if (std::chrono::duration<GLfloat, std::milli>(Clock::now() - start).count() >= budget)
+            break;
+    }
+    return converged;
+}
@@ -0,0 +1,100 @@
+/**
+ * optimizer.h
+ * This file contains the SurfaceOptimizer class, a FiberMesh-style
+ * (Nealen et al. 2007) curvature-minimizing optimizer. Every iteration
+ * alternates two sparse least-squares solves over the uniform Laplacian L:
+ *
+ *     curvature   min |L c|^2 + |c - c'|^2,  c' = (L x) . n
+ *     position    min |L x - c n|^2 + sum W^2 |x_i - x0_i|^2
+ *
+ * so the scalar Laplacian magnitudes are smoothed first and the vertices
+ * then follow them along their normals. Silhouette vertices carry a large
+ * W and keep the sketched outline; every other vertex is anchored weakly
+ * to its inflated position. Both system matrices depend only on the
+ * topology, so each is factorized once and every later iteration, frame
+ * and re-inflation of the same topology is a pair of back substitutions
+ * starting from the previous solution.
+ */
+
+#ifndef _OPTIMIZER_H_
+#define _OPTIMIZER_H_
+
+#ifdef __APPLE__
+#include <OpenGL/gl.h>
+#else
+#include <GL/gl.h>
+#endif
+
+#include <vector>
+#include <Eigen/Core>
+#include "mesh.h"
+#include "fairing.h"
+#include "adjacency.h"
+
+using std::vector;
+using Eigen::Vector3f;
+
+// Anchor weights of silhouette and of all other vertices
+const double OPTIMIZE_PIN    = 1e3;
+const double OPTIMIZE_ANCHOR = 1e-1;
+
+// Converged once no vertex moves more than this fraction of the extent
+const GLfloat OPTIMIZE_TOLERANCE = 1e-4f;
+const GLuint  OPTIMIZE_MAX_ITERATIONS = 200;
+
+class SurfaceOptimizer
+{
+public:
+    vector<Vector3f> positions;     // current solution
+    GLuint iterations;              // since begin
+    GLuint factorizations;          // since construction
+
+    SurfaceOptimizer(void)
+        : iterations(0), factorizations(0), vertex_count(0), topology(0),
+          converged(GL_TRUE) {}
+
+    /**
+     * begin
+     * Anchors the optimization to verts, pinning the silhouette vertices.
+     * When the faces and silhouette are unchanged the factorizations are
+     * kept and the previous solution is the starting point; otherwise it
+     * starts from verts and copies the adjacency of faces.
+     */
+    void begin(const vector<Vector3f> &verts, const vector<Triangle> &faces,
+        const vector<GLuint> &silhouette, const Adjacency &adjacency);
+
+    /**
+     * step
+     * Runs whole iterations until budget milliseconds have passed (at least
+     * one) or the surface converges.
+     * @return GLboolean - GL_TRUE once there is nothing left to do
+     */
+    GLboolean step(GLfloat budget);
+
+    GLboolean done(void) const
+        { return converged; }
+
+private:
+    typedef Eigen::SparseMatrix<double> SparseMatrix;
+    typedef Eigen::SimplicialLDLT<SparseMatrix> Solver;
+
+    GLuint vertex_count;
+    unsigned long long topology;    // hash of the factorized faces
+    GLboolean converged;
+    GLfloat tolerance;
+
+    vector<Triangle> faces;
+    Adjacency adjacency;
+    SparseMatrix laplacian, laplacian_t;
+    Solver curvature_solver, position_solver;
+    vector<double> anchor;          // W^2 per vertex
+
+    Eigen::MatrixX3d x, anchored, delta, rhs;
+    Eigen::VectorXd curvature;
+    vector<Vector3f> normals;
+
+    void factorize(void);
+    void iterate(void);
+};
+
+#endif
@@ -0,0 +1,110 @@
+#include "preview.h"
+#include "spatialhash.h"
+
+#include <algorithm>
+#include <cmath>
+
+/**
+ * resample
+ * Places outline points at equal arc length around the closed stroke. The
+ * spacing widens for long strokes so the outline stays within
+ * PREVIEW_MAX_POINTS.
+ */
+void Preview::resample(void)
+{
+    outline.clear();
+    GLuint n = stroke.size();
+    if (n < 3) return;
+
+    GLfloat perimeter = 0.0f;
+    for (GLuint i = 0; i < n; i++)
+        perimeter += (stroke[(i + 1) % n] - stroke[i]).head<2>().norm();
+    GLfloat spacing = std::max(PREVIEW_SPACING, perimeter / PREVIEW_MAX_POINTS);
+
+    // Distance walked past the last placed point
+    GLfloat walked = 0.0f;
+    outline.push_back(stroke[0]);
+    for (GLuint i = 0; i < n; i++) {
+        const Vector3f &a = stroke[i], &b = stroke[(i + 1) % n];
+        GLfloat length = (b - a).head<2>().norm();
+        GLfloat t = spacing - walked;
+        for (; t < length; t += spacing)
+            outline.push_back(a + (b - a) * (t / length));
+        walked = length - (t - spacing);
+    }
+
+    // The last point may sit on top of the first
+    if (outline.size() > 1 &&
+        (outline.back() - outline[0]).head<2>().norm() < spacing / 2)
+        outline.pop_back();
+}
+
+GLuint Preview::drain(EventQueue &queue)
+{
+    InputEvent event;
+    GLuint applied = 0;
+
+    for (; queue.pop(event); applied++) {
+        if (event.type == INPUT_DOWN)
+            points.clear();
+        else if (event.type == INPUT_MOTION)
+            points.push_back(Vector3f(event.x, event.y, 0));
+    }
+    return applied;
+}
+
+GLboolean Preview::build(const Background &jobs, GLuint generation, ThreadPool *pool)
+{
+    resample();
+    if (outline.size() < 3 || !triangulation.triangulate(outline)) {
+        empty_builds++;
+        return GL_FALSE;
+    }
+    if (jobs.cancelled(generation)) return GL_FALSE;
+
+    if (!spine.build(triangulation)) {
+        empty_builds++;
+        return GL_FALSE;
+    }
+    builder.fromSpine(spine, triangulation);
+    if (builder.empty()) {
+        empty_builds++;
+        return GL_FALSE;
+    }
+    if (jobs.cancelled(generation)) return GL_FALSE;
+
+    builder.buildVertices(0.0f, PREVIEW_SEGMENTS, circles, back_verts, pool);
+    builder.buildFaces(back_faces);
+    scratch.reset();
+    weldVertices(back_verts, back_faces, weldDistance(back_verts), &scratch);
+    if (back_faces.empty()) {
+        empty_builds++;
+        return GL_FALSE;
+    }
+
+    // Bounds to frame the preview by
+    Vector3f lo = back_verts[0], hi = back_verts[0];
+    for (GLuint i = 1; i < back_verts.size(); i++) {
+        lo = lo.cwiseMin(back_verts[i]);
+        hi = hi.cwiseMax(back_verts[i]);
+    }
+    back_center = (lo + hi) / 2;
+    back_radius = (hi - lo).norm() / 2;
+    return GL_TRUE;
+}
+
+void Preview::publish(void)
+{
+    verts.swap(back_verts);
+    faces.swap(back_faces);
+    center = back_center;
+    radius = back_radius;
+    published++;
+}
+
+void Preview::clear(void)
+{
+    verts.clear();
+    faces.clear();
+    radius = 0.0f;
+}
@@ -0,0 +1,110 @@
+/**
+ * preview.h
+ * This file contains the Preview class, which inflates a coarse mesh from
+ * a stroke that is still being drawn. It runs the same stages as the full
+ * mesh: outline, triangulation, spine and tubes, but resamples the outline
+ * at a wide spacing and uses the lowest ring preset, so a build takes a
+ * few milliseconds. Every stage owns its storage across builds. A build
+ * writes a back buffer that publish swaps to the front, so the drawn mesh
+ * is never one still being written. The stroke arrives as input events,
+ * drained on the thread that builds.
+ */
+
+#ifndef _PREVIEW_H_
+#define _PREVIEW_H_
+
+#ifdef __APPLE__
+#include <OpenGL/gl.h>
+#else
+#include <GL/gl.h>
+#endif
+
+#include <vector>
+#include <Eigen/Core>
+#include "mesh.h"
+#include "triangulation.h"
+#include "spine.h"
+#include "inflation.h"
+#include "meshbuilder.h"
+#include "scratch.h"
+#include "background.h"
+#include "eventqueue.h"
+#include "threadpool.h"
+
+using std::vector;
+using Eigen::Vector3f;
+
+// Outline spacing in pixels, and the most outline points a preview uses
+const GLfloat PREVIEW_SPACING    = 12.0f;
+const GLuint  PREVIEW_MAX_POINTS = 96;
+
+// Ring segments of every preview ring, the lowest preset
+const GLuint PREVIEW_SEGMENTS = RING_PRESETS[0];
+
+class Preview
+{
+public:
+    // Stroke gathered from input events, and the closed copy to build from
+    vector<Vector3f> points;
+    vector<Vector3f> stroke;
+
+    // Last published mesh, and the center and radius of its bounds
+    vector<Vector3f> verts;
+    vector<Triangle> faces;
+    Vector3f center;
+    GLfloat radius;
+
+    // Builds that were published, and that found no shape to inflate
+    GLuint published, empty_builds;
+
+    Preview(void)
+        : center(0, 0, 0), radius(0.0f), published(0), empty_builds(0),
+          back_center(0, 0, 0), back_radius(0.0f) {}
+
+    /**
+     * drain
+     * Applies every queued event to points: a press starts a new stroke
+     * and motion extends it.
+     * @return GLuint - events applied
+     */
+    GLuint drain(EventQueue &queue);
+
+    /**
+     * build
+     * Inflates stroke into the back buffer, returning early once
+     * jobs.cancelled(generation). Runs on the background thread.
+     * @return GLboolean - GL_FALSE if cancelled or nothing was inflated
+     */
+    GLboolean build(const Background &jobs, GLuint generation, ThreadPool *pool);
+
+    /**
+     * publish
+     * Swaps the back buffer of the last complete build to the front.
+     */
+    void publish(void);
+
+    /**
+     * clear
+     * Empties the published mesh while keeping allocated storage. The
+     * stroke and back buffer belong to the thread that builds, which
+     * starts them over at the next INPUT_DOWN.
+     */
+    void clear(void);
+
+private:
+    vector<Vector3f> outline;       // stroke resampled at the preview spacing
+    vector<Vector3f> back_verts;
+    vector<Triangle> back_faces;
+    Vector3f back_center;
+    GLfloat back_radius;
+
+    Triangulation triangulation;
+    Spine spine;
+    MeshBuilder builder;
+    CircleCache circles;
+    Arena scratch;                  // weld scratch, reset every build
+
+    void resample(void);
+};
+
+#endif
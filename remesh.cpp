@@ -0,0 +1,399 @@
+#include "remesh.h"
+
+#include <algorithm>
+#include <cmath>
+
+// Half-edges or vertices per parallel slice
+static const GLuint REMESH_GRAIN = 4096;
+
+/**
+ * forRange
+ * Runs body over [0, n), split across the pool when given.
+ */
+template <class F>
+static void forRange(ThreadPool *pool, GLuint n, F body)
+{
+    auto slice = [&](GLuint begin, GLuint end) {
+        for (GLuint i = begin; i < end; i++) body(i);
+    };
+    if (pool) pool->parallelFor(0, n, REMESH_GRAIN, slice);
+    else      slice(0, n);
+}
+
+static Vector3f faceNormal(const Vector3f &a, const Vector3f &b, const Vector3f &c)
+{
+    return (b - a).cross(c - a);
+}
+
+void Remesher::build(const vector<Vector3f> &verts, const vector<Triangle> &faces,
+    const vector<GLuint> *pins, ThreadPool *pool)
+{
+    GLuint nv = verts.size();
+
+    pos = verts;
+    mesh.build(nv, faces, pool);
+
+    pinned.assign(nv, 0);
+    if (pins)
+        for (GLuint k = 0; k < pins->size(); k++)
+            if ((*pins)[k] < nv) pinned[(*pins)[k]] = 1;
+
+    locked.resize(nv);
+    forRange(pool, nv, [&](GLuint v) {
+        locked[v] = (mesh.valence[v] < 3 || !mesh.interior(v) || pinned[v]);
+    });
+
+    claim.assign(nv, 0);
+    stamp = 0;
+}
+
+/**
+ * claimRegion
+ * Marks the vertices for this round unless one is already taken.
+ * @return GLboolean - GL_TRUE if the region was free
+ */
+GLboolean Remesher::claimRegion(const GLint *region, GLuint n)
+{
+    for (GLuint k = 0; k < n; k++)
+        if (claim[region[k]] == stamp) return GL_FALSE;
+    for (GLuint k = 0; k < n; k++)
+        claim[region[k]] = stamp;
+    return GL_TRUE;
+}
+
+GLfloat Remesher::splitScore(GLint h) const
+{
+    GLfloat length = (pos[dest(h)] - pos[mesh.vert[h]]).norm();
+    return (length > high) ? length : 0.0f;
+}
+
+/**
+ * collapseScore
+ * Accepts a short edge between interior vertices when the link condition
+ * holds, no edge at the midpoint exceeds the split length and no
+ * surrounding face turns over.
+ * @return GLfloat - higher for shorter edges, 0 to reject
+ */
+GLfloat Remesher::collapseScore(GLint h) const
+{
+    static thread_local vector<GLint> ring_a, ring_b;
+    GLint a = mesh.vert[h], b = dest(h), t = mesh.twin[h];
+    GLint c = mesh.vert[prev(h)], d = mesh.vert[prev(t)];
+    GLfloat length = (pos[b] - pos[a]).norm();
+
+    if (length >= low || locked[a] || locked[b] || c == d) return 0.0f;
+    if (mesh.valence[c] <= 3 || mesh.valence[d] <= 3) return 0.0f;
+
+    mesh.neighbors(a, ring_a);
+    mesh.neighbors(b, ring_b);
+    GLuint common = 0;
+    for (GLuint i = 0; i < ring_a.size(); i++)
+        common += std::count(ring_b.begin(), ring_b.end(), ring_a[i]);
+    if (common != 2) return 0.0f;
+
+    Vector3f mid = 0.5f * (pos[a] + pos[b]);
+    for (GLuint side = 0; side < 2; side++) {
+        GLint v = side ? b : a;
+        const vector<GLint> &ring = side ? ring_b : ring_a;
+
+        for (GLuint i = 0; i < ring.size(); i++)
+            if (ring[i] != a && ring[i] != b && (pos[ring[i]] - mid).norm() >= high)
+                return 0.0f;
+
+        GLint e = mesh.out[v];
+        do {
+            GLint f = e / 3;
+            if (f != h / 3 && f != t / 3) {
+                const Vector3f &p = pos[dest(e)], &q = pos[mesh.vert[prev(e)]];
+                if (faceNormal(pos[v], p, q).dot(faceNormal(mid, p, q)) <= 0.0f)
+                    return 0.0f;
+            }
+            e = mesh.rotate(e);
+        } while (e != mesh.out[v]);
+    }
+    return low - length;
+}
+
+/**
+ * flipScore
+ * Accepts an interior edge whose flip brings the four valences closer to
+ * 6 without folding the quad.
+ * @return GLfloat - the drop in squared valence deviation, 0 to reject
+ */
+GLfloat Remesher::flipScore(GLint h) const
+{
+    static thread_local vector<GLint> ring;
+    GLint a = mesh.vert[h], b = dest(h), t = mesh.twin[h];
+    GLint c = mesh.vert[prev(h)], d = mesh.vert[prev(t)];
+
+    if (locked[a] || locked[b] || locked[c] || locked[d] || c == d) return 0.0f;
+    if (mesh.valence[a] <= 3 || mesh.valence[b] <= 3) return 0.0f;
+
+    GLint va = mesh.valence[a] - 6, vb = mesh.valence[b] - 6;
+    GLint vc = mesh.valence[c] - 6, vd = mesh.valence[d] - 6;
+    GLint before = va * va + vb * vb + vc * vc + vd * vd;
+    GLint after = (va - 1) * (va - 1) + (vb - 1) * (vb - 1) +
+                  (vc + 1) * (vc + 1) + (vd + 1) * (vd + 1);
+    if (after >= before) return 0.0f;
+
+    mesh.neighbors(c, ring);
+    if (std::find(ring.begin(), ring.end(), d) != ring.end()) return 0.0f;
+
+    Vector3f n = faceNormal(pos[a], pos[b], pos[c]) + faceNormal(pos[b], pos[a], pos[d]);
+    if (faceNormal(pos[a], pos[d], pos[c]).dot(n) <= 0.0f ||
+        faceNormal(pos[d], pos[b], pos[c]).dot(n) <= 0.0f)
+        return 0.0f;
+    return (GLfloat)(before - after);
+}
+
+/**
+ * split
+ * Splits edge a->b of faces (a, b, c) and (b, a, d) at new vertex m into
+ * (a, m, c), (m, a, d) in place and (m, b, c), (b, m, d) at face.
+ */
+void Remesher::split(GLint h, GLint m, GLint face)
+{
+    GLint h1 = next(h), h2 = prev(h), t = mesh.twin[h], t2 = prev(t);
+    GLint a = mesh.vert[h], b = mesh.vert[h1], c = mesh.vert[h2], d = mesh.vert[t2];
+    GLint s0 = 3 * face, s1 = s0 + 1, s2 = s0 + 2;
+    GLint u0 = s0 + 3, u1 = s0 + 4, u2 = s0 + 5;
+    GLint bc = mesh.twin[h1], db = mesh.twin[t2];
+
+    pos[m] = 0.5f * (pos[a] + pos[b]);
+
+    mesh.vert[h1] = m;
+    mesh.vert[s0] = m; mesh.vert[s1] = b; mesh.vert[s2] = c;
+    mesh.vert[t]  = m;
+    mesh.vert[u0] = b; mesh.vert[u1] = m; mesh.vert[u2] = d;
+
+    mesh.twin[s0] = u0; mesh.twin[u0] = s0;
+    mesh.twin[h1] = s2; mesh.twin[s2] = h1;
+    mesh.twin[t2] = u1; mesh.twin[u1] = t2;
+    mesh.twin[s1] = bc; if (bc >= 0) mesh.twin[bc] = s1;
+    mesh.twin[u2] = db; if (db >= 0) mesh.twin[db] = u2;
+
+    mesh.out[m] = h1; mesh.out[a] = h; mesh.out[b] = s1; mesh.out[c] = h2; mesh.out[d] = t2;
+    mesh.valence[m] = 4;
+    mesh.valence[c]++;
+    mesh.valence[d]++;
+    locked[m] = pinned[m] = pinned[a] && pinned[b];
+    claim[m] = stamp;
+}
+
+/**
+ * collapse
+ * Merges a into b at the midpoint of edge a->b, removing faces (a, b, c)
+ * and (b, a, d) and gluing their outer edges.
+ */
+void Remesher::collapse(GLint h)
+{
+    GLint h1 = next(h), h2 = prev(h), t = mesh.twin[h], t1 = next(t), t2 = prev(t);
+    GLint a = mesh.vert[h], b = mesh.vert[h1], c = mesh.vert[h2], d = mesh.vert[t2];
+    GLint cb = mesh.twin[h1], ac = mesh.twin[h2], ad = mesh.twin[t1], db = mesh.twin[t2];
+
+    GLint e = mesh.out[a];
+    do {
+        mesh.vert[e] = b;
+        e = mesh.rotate(e);
+    } while (e != mesh.out[a]);
+
+    mesh.twin[cb] = ac; mesh.twin[ac] = cb;
+    mesh.twin[ad] = db; mesh.twin[db] = ad;
+    mesh.vert[h] = mesh.vert[h1] = mesh.vert[h2] = -1;
+    mesh.vert[t] = mesh.vert[t1] = mesh.vert[t2] = -1;
+
+    pos[b] = 0.5f * (pos[a] + pos[b]);
+    mesh.out[a] = -1;
+    mesh.out[b] = ac; mesh.out[c] = cb; mesh.out[d] = ad;
+    mesh.valence[b] += mesh.valence[a] - 4;
+    mesh.valence[c]--;
+    mesh.valence[d]--;
+}
+
+/**
+ * flip
+ * Turns faces (a, b, c) and (b, a, d) into (d, c, a) and (c, d, b).
+ */
+void Remesher::flip(GLint h)
+{
+    GLint h1 = next(h), h2 = prev(h), t = mesh.twin[h], t1 = next(t), t2 = prev(t);
+    GLint a = mesh.vert[h], b = mesh.vert[h1], c = mesh.vert[h2], d = mesh.vert[t2];
+    GLint ca = mesh.twin[h2], ad = mesh.twin[t1], db = mesh.twin[t2], bc = mesh.twin[h1];
+
+    mesh.vert[h] = d;  mesh.vert[h1] = c; mesh.vert[h2] = a;
+    mesh.vert[t] = c;  mesh.vert[t1] = d; mesh.vert[t2] = b;
+
+    mesh.twin[h1] = ca; if (ca >= 0) mesh.twin[ca] = h1;
+    mesh.twin[h2] = ad; if (ad >= 0) mesh.twin[ad] = h2;
+    mesh.twin[t1] = db; if (db >= 0) mesh.twin[db] = t1;
+    mesh.twin[t2] = bc; if (bc >= 0) mesh.twin[bc] = t2;
+
+    mesh.out[a] = h2; mesh.out[b] = t2; mesh.out[c] = h1; mesh.out[d] = t1;
+    mesh.valence[a]--;
+    mesh.valence[b]--;
+    mesh.valence[c]++;
+    mesh.valence[d]++;
+}
+
+/**
+ * pass
+ * Repeats rounds of: score edges in parallel, claim the regions of the
+ * best candidates in order, apply the claimed ones in parallel. After the
+ * first round only edges touching a vertex claimed in the previous round
+ * are scored again; every claim rescores its edge, so a stale score can
+ * delay an operation but never admit an invalid one. Operations adding
+ * vertices get extra vertices and 2 * extra faces each, numbered by their
+ * place in the claim order.
+ * @return GLuint - operations applied
+ */
+template <class Score, class Region, class Apply>
+GLuint Remesher::pass(ThreadPool *pool, Score scoreEdge, Region region,
+    Apply apply, GLuint extra)
+{
+    GLuint total = 0;
+
+    for (GLuint round = 0; round < REMESH_ROUNDS; round++) {
+        GLuint nh = mesh.vert.size(), dirty = stamp;
+
+        score.resize(nh, 0.0f);
+        forRange(pool, nh, [&](GLuint h) {
+            if (mesh.vert[h] < 0 || mesh.twin[h] <= (GLint)h) {
+                score[h] = 0.0f;
+                return;
+            }
+            if (round == 0 || claim[mesh.vert[h]] == dirty || claim[dest(h)] == dirty)
+                score[h] = scoreEdge(h);
+        });
+
+        candidates.clear();
+        for (GLuint h = 0; h < nh; h++) {
+            if (score[h] <= 0.0f) continue;
+            Candidate c = { score[h], (GLint)h };
+            candidates.push_back(c);
+        }
+        if (candidates.empty()) break;
+        std::sort(candidates.begin(), candidates.end());
+
+        stamp++;
+        chosen.clear();
+        for (GLuint k = 0; k < candidates.size(); k++) {
+            GLint h = candidates[k].edge;
+            GLint quad[4] = { mesh.vert[h], dest(h), mesh.vert[prev(h)], mesh.vert[prev(mesh.twin[h])] };
+            if (claim[quad[0]] == stamp || claim[quad[1]] == stamp ||
+                claim[quad[2]] == stamp || claim[quad[3]] == stamp)
+                continue;
+
+            if ((score[h] = scoreEdge(h)) <= 0.0f) continue;
+            region(h, area);
+            if (claimRegion(area.data(), area.size()))
+                chosen.push_back(h);
+        }
+
+        GLuint nv = pos.size(), nf = mesh.vert.size() / 3, count = chosen.size();
+        if (extra) {
+            pos.resize(nv + extra * count);
+            mesh.out.resize(pos.size());
+            mesh.valence.resize(pos.size());
+            locked.resize(pos.size());
+            pinned.resize(pos.size());
+            claim.resize(pos.size());
+            mesh.vert.resize(3 * (nf + 2 * extra * count));
+            mesh.twin.resize(mesh.vert.size());
+        }
+        forRange(pool, count, [&](GLuint k) {
+            apply(chosen[k], nv + extra * k, nf + 2 * extra * k);
+        });
+        total += count;
+        if (count == 0) break;
+    }
+    return total;
+}
+
+/**
+ * relax
+ * Moves every interior vertex to the centroid of its neighbors, projected
+ * onto its tangent plane.
+ */
+void Remesher::relax(ThreadPool *pool)
+{
+    relaxed.resize(pos.size());
+    forRange(pool, pos.size(), [&](GLuint v) {
+        relaxed[v] = pos[v];
+        if (mesh.out[v] < 0 || locked[v]) return;
+
+        Vector3f centroid(0.0f, 0.0f, 0.0f), normal(0.0f, 0.0f, 0.0f);
+        GLuint n = 0;
+        GLint h = mesh.out[v];
+        do {
+            const Vector3f &p = pos[dest(h)];
+            centroid += p;
+            normal += faceNormal(pos[v], p, pos[mesh.vert[prev(h)]]);
+            n++;
+            h = mesh.rotate(h);
+        } while (h != mesh.out[v]);
+
+        GLfloat len = normal.norm();
+        Vector3f step = centroid / n - pos[v];
+        if (len > 0.0f) {
+            normal /= len;
+            step -= normal.dot(step) * normal;
+        }
+        relaxed[v] = pos[v] + step;
+    });
+    pos.swap(relaxed);
+}
+
+void Remesher::remesh(vector<Vector3f> &verts, vector<Triangle> &faces,
+    GLfloat target, GLuint iterations, ThreadPool *pool, vector<GLuint> *pins)
+{
+    splits = collapses = flips = 0;
+    build(verts, faces, pins, pool);
+
+    if (target <= 0.0f) {
+        GLdouble sum = 0.0;
+        GLuint edges = 0;
+        for (GLuint h = 0; h < mesh.vert.size(); h++) {
+            if (mesh.twin[h] >= 0 && mesh.twin[h] < (GLint)h) continue;
+            sum += (pos[dest(h)] - pos[mesh.vert[h]]).norm();
+            edges++;
+        }
+        target = edges ? sum / edges : 0.0f;
+    }
+    low  = 0.8f * target;
+    high = 4.0f / 3.0f * target;
+
+    auto quad = [this](GLint h, vector<GLint> &area) {
+        area.assign(4, mesh.vert[h]);
+        area[1] = dest(h);
+        area[2] = mesh.vert[prev(h)];
+        area[3] = mesh.vert[prev(mesh.twin[h])];
+    };
+    auto link = [this](GLint h, vector<GLint> &area) {
+        mesh.neighbors(mesh.vert[h], area);
+        mesh.neighbors(dest(h), link_ring);
+        area.insert(area.end(), link_ring.begin(), link_ring.end());
+    };
+
+    for (GLuint it = 0; it < iterations && target > 0.0f; it++) {
+        splits += pass(pool,
+            [this](GLint h) { return splitScore(h); }, quad,
+            [this](GLint h, GLint m, GLint f) { split(h, m, f); }, 1);
+        collapses += pass(pool,
+            [this](GLint h) { return collapseScore(h); }, link,
+            [this](GLint h, GLint, GLint) { collapse(h); }, 0);
+        flips += pass(pool,
+            [this](GLint h) { return flipScore(h); }, quad,
+            [this](GLint h, GLint, GLint) { flip(h); }, 0);
+        relax(pool);
+    }
+
+    if (!pins) {
+        mesh.extract(pos, verts, faces);
+        return;
+    }
+    mesh.extract(pos, verts, faces, &renumber);
+    pins->clear();
+    for (GLuint v = 0; v < pos.size(); v++)
+        if (pinned[v] && renumber[v] >= 0) pins->push_back(renumber[v]);
+    std::sort(pins->begin(), pins->end());
+}
@@ -0,0 +1,104 @@
+/**
+ * remesh.h
+ * This file contains the Remesher class, an isotropic remesher after
+ * Botsch & Kobbelt (2004). Every iteration splits edges longer than 4/3
+ * of the target length, collapses edges shorter than 4/5 of it, flips
+ * edges toward valence 6 and relaxes vertices tangentially, which turns
+ * the long ring triangles of inflated meshes and any loaded mesh into
+ * near-equilateral triangles of one size.
+ *
+ * The mesh is held as a HalfEdgeMesh, edited in place. Every pass
+ * scores all edges in parallel, picks in priority order a set of
+ * operations whose vertex neighborhoods do not overlap, and applies that
+ * set in parallel; the result does not depend on the thread count.
+ * Boundary, non-manifold and pinned vertices are never moved or removed.
+ */
+
+#ifndef _REMESH_H_
+#define _REMESH_H_
+
+#ifdef __APPLE__
+#include <OpenGL/gl.h>
+#else
+#include <GL/gl.h>
+#endif
+
+#include <vector>
+#include <Eigen/Core>
+#include "mesh.h"
+#include "halfedge.h"
+#include "threadpool.h"
+
+using std::vector;
+using Eigen::Vector3f;
+
+const GLuint REMESH_ITERATIONS = 5;
+
+// Rounds of independent sets per pass before moving on
+const GLuint REMESH_ROUNDS = 8;
+
+class Remesher
+{
+public:
+    // Operations applied by the last remesh
+    GLuint splits, collapses, flips;
+
+    Remesher(void) : splits(0), collapses(0), flips(0), stamp(0) {}
+
+    /**
+     * remesh
+     * Remeshes verts and faces in place toward edges of length target, or
+     * the mean edge length when target is 0. Unreferenced vertices and
+     * degenerate faces are dropped. The vertices in pins, if given, stay
+     * in place, as do the midpoints split between two of them; pins is
+     * renumbered to the output and sorted.
+     */
+    void remesh(vector<Vector3f> &verts, vector<Triangle> &faces,
+        GLfloat target, GLuint iterations, ThreadPool *pool,
+        vector<GLuint> *pins = NULL);
+
+private:
+    struct Candidate {
+        GLfloat priority;
+        GLint   edge;
+
+        bool operator<(const Candidate &c) const
+            { return priority > c.priority || (priority == c.priority && edge < c.edge); }
+    };
+
+    vector<Vector3f> pos, relaxed;
+    HalfEdgeMesh mesh;
+    vector<unsigned char> locked;   // boundary, non-manifold or pinned
+    vector<unsigned char> pinned;
+    vector<GLint> renumber;         // output index of every vertex
+    vector<GLuint> claim;
+    GLuint stamp;
+
+    vector<GLfloat> score;          // per half-edge, > 0 for candidates
+    vector<Candidate> candidates;
+    vector<GLint> chosen;
+    vector<GLint> area, link_ring;  // region of the candidate being claimed
+    GLfloat low, high;
+
+    static GLint next(GLint h) { return HalfEdgeMesh::next(h); }
+    static GLint prev(GLint h) { return HalfEdgeMesh::prev(h); }
+    GLint dest(GLint h) const { return mesh.dest(h); }
+
+    void build(const vector<Vector3f> &verts, const vector<Triangle> &faces,
+        const vector<GLuint> *pins, ThreadPool *pool);
+    GLboolean claimRegion(const GLint *region, GLuint n);
+
+    GLfloat splitScore(GLint h) const;
+    GLfloat collapseScore(GLint h) const;
+    GLfloat flipScore(GLint h) const;
+    void split(GLint h, GLint m, GLint face);
+    void collapse(GLint h);
+    void flip(GLint h);
+
+    template <class Score, class Region, class Apply>
+    GLuint pass(ThreadPool *pool, Score scoreEdge, Region region, Apply apply,
+        GLuint extra);
+    void relax(ThreadPool *pool);
+};
+
+#endif
@@ -0,0 +1,214 @@
+#include "rendermesh.h"
+#include "fairing.h"
+
+#include <algorithm>
+#include <cmath>
+
+/**
+ * meshScale
+ * Loaded OBJs are usually modeled around the unit box or a few units
+ * across, while sketches are in pixels; small meshes are scaled up to
+ * about the size of a sketch.
+ */
+static GLfloat meshScale(GLfloat radius)
+{
+    if (radius <= 1.0f)  return 200.0f;
+    if (radius <= 20.0f) return 50.0f;
+    return 1.0f;
+}
+
+GLboolean RenderMesh::build(GLuint n, const vector<Triangle> &faces)
+{
+    unsigned long long key = faceHash(n, faces);
+    if (builds && n == vertex_count && key == topology)
+        return GL_FALSE;
+
+    vertex_count = n;
+    topology = key;
+    short_indices.clear();
+    meshlets.clear();
+    meshlet_verts.clear();
+    meshlet_indices.clear();
+
+    if (n <= RENDER_SHORT_LIMIT) {
+        index_type = GL_UNSIGNED_SHORT;
+        short_indices.reserve(3 * faces.size());
+        for (GLuint f = 0; f < faces.size(); f++) {
+            const Triangle &t = faces[f];
+            if (t.vertex1 >= n || t.vertex2 >= n || t.vertex3 >= n) continue;
+            short_indices.push_back(t.vertex1);
+            short_indices.push_back(t.vertex2);
+            short_indices.push_back(t.vertex3);
+        }
+        triangle_count = short_indices.size() / 3;
+    } else {
+        index_type = GL_UNSIGNED_BYTE;
+        buildMeshlets(faces);
+    }
+    builds++;
+    return GL_TRUE;
+}
+
+/**
+ * buildMeshlets
+ * Grows every meshlet breadth first over faces that share a vertex, from
+ * the first face that did not fit the last one, and closes it when the
+ * next face would bring in too many vertices or triangles. Compact patches
+ * keep the vertices repeated across meshlet borders few.
+ */
+void RenderMesh::buildMeshlets(const vector<Triangle> &faces)
+{
+    GLuint n = vertex_count, f, k;
+
+    // Faces around every vertex, by counting sort
+    vector<GLuint> first(n + 1, 0), around;
+    vector<GLboolean> done(faces.size(), GL_TRUE);
+    for (f = 0; f < faces.size(); f++) {
+        const Triangle &t = faces[f];
+        if (t.vertex1 >= n || t.vertex2 >= n || t.vertex3 >= n) continue;
+        first[t.vertex1 + 1]++;
+        first[t.vertex2 + 1]++;
+        first[t.vertex3 + 1]++;
+        done[f] = GL_FALSE;
+    }
+    for (GLuint i = 0; i < n; i++) first[i + 1] += first[i];
+    around.resize(first[n]);
+    {
+        vector<GLuint> fill(first.begin(), first.end() - 1);
+        for (f = 0; f < faces.size(); f++) {
+            if (done[f]) continue;
+            around[fill[faces[f].vertex1]++] = f;
+            around[fill[faces[f].vertex2]++] = f;
+            around[fill[faces[f].vertex3]++] = f;
+        }
+    }
+
+    vector<GLint> local(n, -1);                 // slot in the open meshlet
+    vector<GLuint> queue;
+    Meshlet open = {0, 0, 0, 0};
+
+    auto close = [&]() {
+        for (GLuint s = open.vertex_first; s < meshlet_verts.size(); s++)
+            local[meshlet_verts[s]] = -1;
+        if (open.triangle_count) meshlets.push_back(open);
+        open.vertex_first = meshlet_verts.size();
+        open.vertex_count = 0;
+        open.index_first = meshlet_indices.size();
+        open.triangle_count = 0;
+    };
+
+    triangle_count = 0;
+    meshlet_indices.reserve(3 * faces.size());
+    for (GLuint seed = 0; seed < faces.size(); seed++) {
+        if (done[seed]) continue;
+        queue.assign(1, seed);
+        for (GLuint head = 0; head < queue.size(); ) {
+            f = queue[head++];
+            if (done[f]) continue;
+
+            const Triangle &t = faces[f];
+            GLuint v[3] = {t.vertex1, t.vertex2, t.vertex3};
+            GLuint fresh = 0;
+            for (k = 0; k < 3; k++)
+                fresh += local[v[k]] < 0 && (k < 1 || v[k] != v[0]) && (k < 2 || v[k] != v[1]);
+            if (open.vertex_count + fresh > MESHLET_VERTICES ||
+                open.triangle_count == MESHLET_TRIANGLES) {
+                // Start the next meshlet from here
+                close();
+                queue.assign(1, f);
+                head = 0;
+                continue;
+            }
+
+            for (k = 0; k < 3; k++) {
+                if (local[v[k]] < 0) {
+                    local[v[k]] = open.vertex_count++;
+                    meshlet_verts.push_back(v[k]);
+                }
+                meshlet_indices.push_back(local[v[k]]);
+                for (GLuint a = first[v[k]]; a < first[v[k] + 1]; a++)
+                    if (!done[around[a]]) queue.push_back(around[a]);
+            }
+            done[f] = GL_TRUE;
+            open.triangle_count++;
+            triangle_count++;
+        }
+    }
+    close();
+}
+
+void RenderMesh::update(const vector<Vector3f> &verts)
+{
+    if (verts.size() != vertex_count) return;
+
+    GLfloat radius = 0.0f;
+    for (GLuint i = 0; i < vertex_count; i++)
+        radius = std::max(radius, verts[i].squaredNorm());
+    scale = meshScale(sqrtf(radius));
+
+    // Unnormalized face normals weigh every face by its area
+    normals.assign(vertex_count, Vector3f::Zero());
+    auto accumulate = [&](GLuint a, GLuint b, GLuint c) {
+        Vector3f n = (verts[b] - verts[a]).cross(verts[c] - verts[a]);
+        normals[a] += n;
+        normals[b] += n;
+        normals[c] += n;
+    };
+    if (index_type == GL_UNSIGNED_SHORT) {
+        for (GLuint i = 0; i < short_indices.size(); i += 3)
+            accumulate(short_indices[i], short_indices[i + 1], short_indices[i + 2]);
+        return;
+    }
+
+    for (GLuint m = 0; m < meshlets.size(); m++) {
+        const GLuint *slots = &meshlet_verts[meshlets[m].vertex_first];
+        const GLubyte *idx = &meshlet_indices[meshlets[m].index_first];
+        for (GLuint t = 0; t < meshlets[m].triangle_count; t++, idx += 3)
+            accumulate(slots[idx[0]], slots[idx[1]], slots[idx[2]]);
+    }
+
+    // Meshlets draw from their own copies of the vertices they share
+    slot_positions.resize(meshlet_verts.size());
+    slot_normals.resize(meshlet_verts.size());
+    for (GLuint s = 0; s < meshlet_verts.size(); s++) {
+        slot_positions[s] = verts[meshlet_verts[s]];
+        slot_normals[s] = normals[meshlet_verts[s]];
+    }
+}
+
+void RenderMesh::draw(const vector<Vector3f> &verts) const
+{
+    if (!triangle_count || verts.size() != vertex_count) return;
+
+    glPushMatrix();
+    glScalef(scale, scale, scale);
+    glEnableClientState(GL_VERTEX_ARRAY);
+    glEnableClientState(GL_NORMAL_ARRAY);
+
+    if (index_type == GL_UNSIGNED_SHORT) {
+        glVertexPointer(3, GL_FLOAT, sizeof(Vector3f), verts.data());
+        glNormalPointer(GL_FLOAT, sizeof(Vector3f), normals.data());
+        glDrawElements(GL_TRIANGLES, short_indices.size(), GL_UNSIGNED_SHORT,
+                       short_indices.data());
+    } else {
+        for (GLuint m = 0; m < meshlets.size(); m++) {
+            const Meshlet &mesh = meshlets[m];
+            glVertexPointer(3, GL_FLOAT, sizeof(Vector3f), &slot_positions[mesh.vertex_first]);
+            glNormalPointer(GL_FLOAT, sizeof(Vector3f), &slot_normals[mesh.vertex_first]);
+            glDrawElements(GL_TRIANGLES, 3 * mesh.triangle_count, GL_UNSIGNED_BYTE,
+                           &meshlet_indices[mesh.index_first]);
+        }
+    }
+
+    glDisableClientState(GL_NORMAL_ARRAY);
+    glDisableClientState(GL_VERTEX_ARRAY);
+    glPopMatrix();
+}
+
+GLuint RenderMesh::indexBytes(void) const
+{
+    return short_indices.size() * sizeof(GLushort) +
+           meshlet_indices.size() * sizeof(GLubyte) +
+           meshlet_verts.size() * sizeof(GLuint) +
+           meshlets.size() * sizeof(Meshlet);
+}
@@ -0,0 +1,103 @@
+/**
+ * rendermesh.h
+ * This file contains the RenderMesh class, which keeps the displayed mesh
+ * in vertex arrays drawn with glDrawElements. Indices are stored at the
+ * narrowest width the vertex count allows: 16 bits up to 65536 vertices,
+ * and above that the faces are cut into meshlets of at most 256 vertices
+ * whose triangles use 8-bit indices into the meshlet's own vertex list.
+ * The indices are rebuilt only when the faces change; moving vertices only
+ * refreshes the normals and, for meshlets, the gathered positions.
+ */
+
+#ifndef _RENDERMESH_H_
+#define _RENDERMESH_H_
+
+#ifdef __APPLE__
+#include <OpenGL/gl.h>
+#else
+#include <GL/gl.h>
+#endif
+
+#include <vector>
+#include <Eigen/Core>
+#include "mesh.h"
+
+using std::vector;
+using Eigen::Vector3f;
+
+// Largest vertex count drawn with 16-bit indices
+const GLuint RENDER_SHORT_LIMIT = 1 << 16;
+
+// Meshlet capacity: 8-bit local indices, and triangles per draw call
+const GLuint MESHLET_VERTICES  = 256;
+const GLuint MESHLET_TRIANGLES = 512;
+
+/**
+ * Meshlet struct
+ * A run of faces and the vertices they use. The vertices are slots
+ * vertex_first to vertex_first + vertex_count of the meshlet vertex list,
+ * the triangles 3 * triangle_count local indices from index_first.
+ */
+struct Meshlet {
+    GLuint vertex_first, vertex_count;
+    GLuint index_first, triangle_count;
+};
+
+class RenderMesh
+{
+public:
+    GLenum index_type;          // GL_UNSIGNED_SHORT, or GL_UNSIGNED_BYTE for meshlets
+    GLfloat scale;              // applied when drawing; see update
+    GLuint builds;              // index rebuilds since construction
+
+    RenderMesh(void)
+        : index_type(GL_UNSIGNED_SHORT), scale(1.0f), builds(0),
+          vertex_count(0), triangle_count(0), topology(0) {}
+
+    /**
+     * build
+     * Stores the indices of an n vertex mesh, unless the same faces were
+     * already stored. Faces with an out of range index are left out.
+     * @return GLboolean - GL_TRUE if the indices were rebuilt
+     */
+    GLboolean build(GLuint n, const vector<Triangle> &faces);
+
+    /**
+     * update
+     * Recomputes the area-weighted vertex normals and the drawing scale
+     * from the positions of the last built mesh.
+     */
+    void update(const vector<Vector3f> &verts);
+
+    /**
+     * draw
+     * Draws the last built mesh at verts, the positions given to update.
+     */
+    void draw(const vector<Vector3f> &verts) const;
+
+    /**
+     * indexBytes
+     * @return GLuint - bytes of index data, meshlet vertex lists included
+     */
+    GLuint indexBytes(void) const;
+
+    GLuint triangleCount(void) const
+        { return triangle_count; }
+
+private:
+    vector<GLushort> short_indices;
+    vector<Meshlet> meshlets;
+    vector<GLuint> meshlet_verts;       // mesh vertex of every meshlet slot
+    vector<GLubyte> meshlet_indices;
+
+    vector<Vector3f> normals;
+    vector<Vector3f> slot_positions;    // gathered per meshlet slot
+    vector<Vector3f> slot_normals;
+
+    GLuint vertex_count, triangle_count;
+    unsigned long long topology;
+
+    void buildMeshlets(const vector<Triangle> &faces);
+};
+
+#endif
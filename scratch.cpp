@@ -0,0 +1,121 @@
+#include "scratch.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+
+static std::atomic<std::size_t> heap_allocations(0), heap_bytes(0);
+
+// The array and nothrow forms call these, so every plain new is counted
+void *operator new(std::size_t size)
+{
+    heap_allocations.fetch_add(1, std::memory_order_relaxed);
+    heap_bytes.fetch_add(size, std::memory_order_relaxed);
+    void *p = std::malloc(size ? size : 1);
+    if (!p) throw std::bad_alloc();
+    return p;
+}
+
+void operator delete(void *p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete(void *p, std::size_t) noexcept
+{
+    std::free(p);
+}
+
+std::size_t heapAllocations(void)
+{
+    return heap_allocations.load(std::memory_order_relaxed);
+}
+
+std::size_t heapBytes(void)
+{
+    return heap_bytes.load(std::memory_order_relaxed);
+}
+
+Arena::Arena(void)
+    : heap_blocks(0), resets(0), bytes(0), peak(0), current(0)
+{
+}
+
+Arena::~Arena(void)
+{
+    release();
+}
+
+void Arena::release(void)
+{
+    for (std::size_t b = 0; b < blocks.size(); b++)
+        delete[] blocks[b].data;
+    blocks.clear();
+    current = 0;
+}
+
+void *Arena::allocate(std::size_t size, std::size_t align)
+{
+    // Fit in the current block, or in the first later one with room
+    for (; current < blocks.size(); current++) {
+        Block &b = blocks[current];
+        std::uintptr_t base = (std::uintptr_t)b.data;
+        std::size_t start = ((base + b.used + align - 1) & ~(std::uintptr_t)(align - 1)) - base;
+        if (start + size <= b.size) {
+            bytes += start + size - b.used;
+            peak = std::max(peak, bytes);
+            b.used = start + size;
+            return b.data + start;
+        }
+        if (current + 1 < blocks.size()) blocks[current + 1].used = 0;
+    }
+
+    // Blocks double so a sketch's growth takes few of them
+    std::size_t grown = blocks.empty() ? ARENA_BLOCK : 2 * blocks.back().size;
+    Block b = {NULL, std::max(grown, size + align), 0};
+    b.data = new char[b.size];
+    blocks.push_back(b);
+    heap_blocks++;
+    current = blocks.size() - 1;
+    return allocate(size, align);
+}
+
+Arena::Mark Arena::mark(void) const
+{
+    Mark m = {current, blocks.empty() ? 0 : blocks[current].used, bytes};
+    return m;
+}
+
+void Arena::rewind(const Mark &m)
+{
+    if (blocks.empty()) return;
+    current = m.block;
+    blocks[current].used = m.used;
+    bytes = m.bytes;
+}
+
+void Arena::reset(void)
+{
+    std::size_t total = capacity();
+
+    if (blocks.size() > 1 || total > ARENA_RETAIN) {
+        release();
+        if (total > ARENA_RETAIN) total = ARENA_BLOCK;
+        Block b = {new char[total], total, 0};
+        blocks.push_back(b);
+        heap_blocks++;
+    }
+    if (!blocks.empty()) blocks[0].used = 0;
+    current = 0;
+    bytes = 0;
+    resets++;
+}
+
+std::size_t Arena::capacity(void) const
+{
+    std::size_t total = 0;
+    for (std::size_t b = 0; b < blocks.size(); b++)
+        total += blocks[b].size;
+    return total;
+}
@@ -0,0 +1,127 @@
+/**
+ * scratch.h
+ * This file contains the Arena class, a monotonic allocator for the scratch
+ * data of a sketch, and ScratchVector, a vector that allocates from one.
+ * Allocating bumps a pointer and freeing does nothing; rewinding to a mark
+ * releases everything allocated after it, and reset releases everything at
+ * once. Blocks are kept across resets, merged into a single block as large
+ * as all of them, so a sketch no larger than an earlier one runs without
+ * touching the heap.
+ */
+
+#ifndef _SCRATCH_H_
+#define _SCRATCH_H_
+
+#ifdef __APPLE__
+#include <OpenGL/gl.h>
+#else
+#include <GL/gl.h>
+#endif
+
+#include <cstddef>
+#include <new>
+#include <vector>
+
+using std::vector;
+
+// First block size, and the most a reset keeps for the next sketch
+const std::size_t ARENA_BLOCK  = 1 << 20;
+const std::size_t ARENA_RETAIN = 64 << 20;
+
+class Arena
+{
+public:
+    /**
+     * Mark struct
+     * Allocation state to rewind to.
+     */
+    struct Mark {
+        std::size_t block, used, bytes;
+    };
+
+    // Counters since construction, and bytes in use now and at most
+    GLuint heap_blocks;
+    GLuint resets;
+    std::size_t bytes, peak;
+
+    Arena(void);
+    ~Arena(void);
+
+    /**
+     * allocate
+     * @return void* - size bytes aligned to align, a power of two
+     */
+    void *allocate(std::size_t size, std::size_t align);
+
+    Mark mark(void) const;
+    void rewind(const Mark &m);
+
+    /**
+     * reset
+     * Releases every allocation, merging the blocks into one unless they
+     * hold more than ARENA_RETAIN bytes.
+     */
+    void reset(void);
+
+    /**
+     * capacity
+     * @return std::size_t - bytes held in blocks
+     */
+    std::size_t capacity(void) const;
+
+private:
+    struct Block {
+        char *data;
+        std::size_t size, used;
+    };
+
+    vector<Block> blocks;
+    std::size_t current;
+
+    Arena(const Arena &);
+    Arena &operator=(const Arena &);
+
+    void release(void);
+};
+
+/**
+ * ScratchAllocator struct
+ * Allocator for vectors backed by an arena, or by the heap without one.
+ */
+template <class T>
+struct ScratchAllocator {
+    typedef T value_type;
+
+    Arena *arena;
+
+    ScratchAllocator(Arena *arena = NULL) : arena(arena) {}
+    template <class U>
+    ScratchAllocator(const ScratchAllocator<U> &other) : arena(other.arena) {}
+
+    T *allocate(std::size_t n)
+    {
+        if (arena) return static_cast<T *>(arena->allocate(n * sizeof(T), alignof(T)));
+        return static_cast<T *>(::operator new(n * sizeof(T)));
+    }
+    void deallocate(T *p, std::size_t)
+        { if (!arena) ::operator delete(p); }
+
+    template <class U>
+    bool operator==(const ScratchAllocator<U> &other) const { return arena == other.arena; }
+    template <class U>
+    bool operator!=(const ScratchAllocator<U> &other) const { return arena != other.arena; }
+};
+
+template <class T>
+using ScratchVector = vector<T, ScratchAllocator<T> >;
+
+/**
+ * heapAllocations & heapBytes
+ * Calls to the global operator new, which scratch.cpp replaces to count
+ * them, and the bytes they asked for, on every thread since startup. Any
+ * buffer left outside the arena shows up here.
+ */
+std::size_t heapAllocations(void);
+std::size_t heapBytes(void);
+
+#endif
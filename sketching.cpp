@@ -6,15 +6,6 @@
 Trackball trackball;
 GLint objLoaded = 0;
 
-GLfloat distance(Vector3f &a, Vector3f &b)
-{
-    GLfloat xx = pow((b.x() - a.x()), 2);
-    GLfloat yy = pow((b.y() - a.y()), 2);
-    GLfloat zz = pow((b.z() - a.z()), 2);
-
-    return (sqrt(xx + yy + zz));
-}
-
 GLint main(GLint argc, char *argv[])
 {
     glutInit(&argc, argv);
@@ -127,162 +118,624 @@ void wipeCanvas(void)
 
 void resetStroke(void)
 {
-    stroke.clear();
+    // A new sketch makes any job still running stale. Neither is waited
+    // for: the preview worker starts over at the next INPUT_DOWN, and the
+    // old sketch is cleared once the mesh job lets go of it
+    mesh_jobs.cancel();
+    preview_jobs.cancel();
+    mesh_pending = 0;
+    shown_verts.clear();
+    shown_faces.clear();
+    preview.clear();
+    preview_shown = preview_generation;
+    preview_sent = 0;
+
+    sketch_stale = 1;
+    stroke_ahead.clear();
+    stroke_shift_x = 0;
+    stroke_shift_y = 0;
+    if (!mesh_jobs.busy()) {
+        clearSketch();
+    } else if (!mesh_polling) {
+        mesh_polling = 1;
+        glutTimerFunc(MESH_POLL_MS, pollMesh, 0);
+    }
+	display_triangles = 0;
+    tracking  = 0;
+    previousX = 0;
+    previousY = 0;
+    wipeCanvas();
+}
+
+void clearSketch(void)
+{
+    // Strokes drawn meanwhile were kept aside
+    stroke.swap(stroke_ahead);
+    stroke_ahead.clear();
+    sketch_stale = 0;
+
     points_on_curve.clear();
     connected.clear();
-    go_back_for.clear();
 	mesh_verts.clear();
+    mesh_rest.clear();
     check_verts.clear();
     mesh_faces.clear();
-	display_triangles = 0;
+    mesh_silhouette.clear();
+    mesh_published = 0;
+    mesh_version++;
+    verts_version++;
+    triangulation.clear();
+    spine.clear();
+    mesh_builder.reset();
+    sketch_arena.reset();
     triangulated = 0;
-    tracking  = 0;
-    previousX = 0;
-    previousY = 0;
-    wipeCanvas();
+}
+
+vector<Vector3f> &drawnStroke(void)
+{
+    return sketch_stale ? stroke_ahead : stroke;
 }
 
 /********* INTERPOLATION ***************/
-void populateMeshFaces()
+void populateMeshFaces(MeshBuilder &builder, const vector<Vector3f> &verts,
+                       vector<Triangle> &faces)
 {
-    if (mesh_circles.size() == 0 || mesh_verts.size() == 0)
+    if (builder.empty() || verts.size() == 0)
         return;
 
-    GLuint i, j;
-    Circle c1, c2;
-    for (i = 0; i < mesh_circles.size()-1; i++) {
-        c1 = mesh_circles[i];
-        c2 = mesh_circles[i+1];
+    builder.buildFaces(faces);
+}
 
-        for (j = 0; j < numCirclePts; j++) {
-            GLuint p0 = c1.verts[j];
-            GLuint p1 = c1.verts[(j+1) % numCirclePts];
-            GLuint p2 = c2.verts[j];
-            GLuint p3 = c2.verts[(j+1) % numCirclePts];
+void calculateVerticesDriver(const Spine &spine, const Triangulation &tri,
+                             const vector<Pair> &pairs, const vector<Vector3f> &outline,
+                             const Vector3f &last, const CircleCache &circles,
+                             MeshBuilder &builder, vector<Vector3f> &verts,
+                             vector<GLuint> &silhouette)
+{
+    if (spine.size()) {
+        builder.fromSpine(spine, tri);
+    } else {
+        builder.reset();
+        ringsFromConnected(pairs, outline, last, builder);
+    }
 
-            Triangle t0(p0, p3, p2);
-            Triangle t1(p0, p1, p3);
+    // Size every ring from its radius, then inflate them all in one pass
+    builder.buildVertices(adaptive_rings ? ring_tolerance : 0.0f,
+                          RING_PRESETS[ring_preset], circles, verts, &thread_pool);
+    builder.buildSilhouette(silhouette);
+}
 
-            mesh_faces.push_back(t0);
-            mesh_faces.push_back(t1);
-        }
+void ringsFromConnected(const vector<Pair> &pairs, const vector<Vector3f> &outline,
+                        const Vector3f &last, MeshBuilder &builder)
+{
+    if (pairs.size() == 0) return;
+
+    vector<Ring> &rings = builder.rings;
+    Tube tube;
+
+    builder.reserve((pairs.size() + 1) / 2, 1);
+    tube.ring = rings.size();
+    for (GLuint index = 0; index < pairs.size(); index += 2) {
+        const Pair &pair = pairs[index];
+        rings.push_back(Ring(pair.midpoint, pair.half_width, pair.direction));
     }
+    tube.rings = rings.size() - tube.ring;
+    tube.head  = outline[0];
+    tube.tail  = last;
 
-    GLuint first = 0, last = mesh_verts.size()-1;
-    c1 = mesh_circles.front();
-    c2 = mesh_circles.back();
-    for (j = 0; j < numCirclePts; j++) {
-        GLuint p0 = c1.verts[j];
-        GLuint p1 = c1.verts[(j+1) % numCirclePts];
-        GLuint p2 = c2.verts[j];
-        GLuint p3 = c2.verts[(j+1) % numCirclePts];
+    orientRings(rings, tube);
+    builder.tubes.push_back(tube);
+}
 
-        Triangle t0(first, p1, p0);
-        Triangle t1(last , p3, p2);
+void cycleRingPreset(void)
+{
+    ring_preset = (ring_preset + 1) % NUM_RING_PRESETS;
+    printf("Ring segments: %s%u\n", adaptive_rings ? "up to " : "",
+           RING_PRESETS[ring_preset]);
+    rebuildRings();
+}
 
-        mesh_faces.push_back(t0);
-        mesh_faces.push_back(t1);
+void toggleAdaptiveRings(void)
+{
+    adaptive_rings ^= 1;
+    printf("Adaptive rings: %s\n", adaptive_rings ? "on" : "off");
+    rebuildRings();
+}
+
+void toggleOptimizer(void)
+{
+    optimizing ^= 1;
+    printf("Surface optimizer: %s\n", optimizing ? "on" : "off");
+    if (!optimizing) glutIdleFunc(NULL);
+    if (view.type != VIEWING) return;
+    fairMesh();
+    glutPostRedisplay();
+}
+
+void optimizeIdle(void)
+{
+    // The mesh was cleared, replaced or left behind since the last frame
+    if (!optimizing || objLoaded || view.type != VIEWING || mesh_pending ||
+        optimizer.positions.size() != mesh_verts.size()) {
+        glutIdleFunc(NULL);
+        return;
     }
+
+    if (optimizer.step(optimize_budget)) {
+        glutIdleFunc(NULL);
+        printf("Surface optimizer: converged after %u iterations\n",
+               optimizer.iterations);
+    }
+    mesh_verts = optimizer.positions;
+    verts_version++;
+    glutPostRedisplay();
 }
 
-void calculateVerticesDriver()
+void remeshMesh(void)
 {
-    mesh_circles.clear();
-    // loop through connected
-	for (GLuint index = 0; index < connected.size(); index = index+2) {
-        Circle c;
-		//loop through the different degree values
-		for (GLfloat theta = 0; theta < 360; theta += mesh_rotation){
-			calculateVertices(index, ((theta*(PI/180))*(pow(-1, index))));
-            c.verts.push_back(mesh_verts.size());
-		}
-        mesh_circles.push_back(c);
-	}
+    if (view.type != VIEWING || mesh_faces.empty()) return;
+
+    if (objLoaded) {
+        remesher.remesh(mesh_verts, mesh_faces, 0.0f, REMESH_ITERATIONS, &thread_pool);
+        mesh_version++;
+        verts_version++;
+    } else {
+        remesher.remesh(mesh_rest, mesh_faces, 0.0f, REMESH_ITERATIONS, &thread_pool,
+                        &mesh_silhouette);
+        mesh_version++;
+        mesh_verts = mesh_rest;
+        fairMesh();
+    }
+    printf("Remeshed: %u splits, %u collapses, %u flips, %u faces\n",
+           remesher.splits, remesher.collapses, remesher.flips,
+           (GLuint)mesh_faces.size());
+    glutPostRedisplay();
+}
+
+void cycleSubdivision(void)
+{
+    subdivision_level = (subdivision_level + 1) % (MAX_SUBDIVISION_LEVEL + 1);
+    printf("Subdivision levels: %u\n", subdivision_level);
+    glutPostRedisplay();
+}
+
+void printStats(void)
+{
+    // Counted since the last call, so a repeated sketch should add nothing
+    static std::size_t last_allocations = 0, last_bytes = 0;
+    std::size_t allocations = heapAllocations(), bytes = heapBytes();
+    printf("Heap: %zu allocations, %zu KB since last stats\n",
+           allocations - last_allocations, (bytes - last_bytes) >> 10);
+    last_allocations = allocations;
+    last_bytes = bytes;
+
+    printf("Sketch arena: %zu KB in use, peak %zu KB of %zu KB, %u heap blocks, %u resets\n",
+           sketch_arena.bytes >> 10, sketch_arena.peak >> 10, sketch_arena.capacity() >> 10,
+           sketch_arena.heap_blocks, sketch_arena.resets);
+    printf("Mesh builder: %u reallocations\n", mesh_builder.reallocations);
+    printf("Input events: %u pushed, %u dropped, latency %.2f ms mean, %.2f ms max\n",
+           input_events.pushed.load(), input_events.dropped.load(),
+           input_events.meanLatency(), input_events.maxLatency());
+    if (mesh_graphs[inflation_engine].runs)
+        mesh_graphs[inflation_engine].print("Mesh stages");
+}
+
+void rebuildRings(void)
+{
+    // Loaded meshes carry their own tessellation
+    if (objLoaded || mesh_builder.empty() || inflation_engine != ENGINE_TUBES)
+        return;
+
+    inflateSketch();
+    glutPostRedisplay();
+}
+
+void inflateSketch(void)
+{
+    if (!mesh_pending && !sketch_stale && mesh_published) {
+        shown_verts.swap(mesh_verts);
+        shown_faces.swap(mesh_faces);
+    }
+    mesh_pending = 1;
+
+    // A cancelled job still holds the old sketch; pollMesh submits this
+    // one once it is cleared
+    if (!sketch_stale) {
+        mesh_published = 0;
+        mesh_generation = mesh_jobs.submit(generateMesh);
+    }
 
-	std::vector<Vector3f>::iterator v;
-	v = mesh_verts.begin();
-    if (points_on_curve.size()) {
-        mesh_verts.insert(v, points_on_curve[0]);
-        mesh_verts.push_back(last_in_shape);
+    if (!mesh_polling) {
+        mesh_polling = 1;
+        glutTimerFunc(MESH_POLL_MS, pollMesh, 0);
     }
 }
 
-Vector3f calculateMidpoint(GLint index)
+TaskGraph &meshGraph(GLint engine)
 {
-    GLfloat x1, y1, x2, y2, z1, z2;
-    GLfloat xm, ym, zm;
+    TaskGraph &graph = mesh_graphs[engine];
+    if (graph.nodes.size()) return graph;
+
+    MeshSlots &s = mesh_slots[engine];
+    s.stroke        = graph.slot<vector<Vector3f> >();
+    s.outline       = graph.slot<vector<Vector3f> >();
+    s.triangulation = graph.slot<Triangulation>();
+    s.spine         = graph.slot<Spine>();
+    s.pairs         = graph.slot<vector<Pair> >();
+    s.last_in_shape = graph.slot<Vector3f>();
+    s.circles       = graph.slot<CircleCache>();
+    s.builder       = graph.slot<MeshBuilder>();
+    s.implicit      = graph.slot<ImplicitSurface>();
+    s.height        = graph.slot<HeightField>();
+    s.verts         = graph.slot<vector<Vector3f> >();
+    s.faces         = graph.slot<vector<Triangle> >();
+    s.silhouette    = graph.slot<vector<GLuint> >();
+    s.arena         = graph.slot<Arena>();
+
+    // Outline stages, OUTLINE_STAGES of them, clear their output first so
+    // an outline cancelled halfway is redone from scratch
+    graph.add("outline", [s](const TaskGraph::Data &data) {
+        vector<Vector3f> &outline = data.out(s.outline);
+        outline.clear();
+        getOutsideEdges(data.in(s.stroke), outline);
+    });
+    graph.reads(s.stroke);
+    graph.writes(s.outline);
+    graph.add("triangulate", [s](const TaskGraph::Data &data) {
+        triangulateOutline(data.in(s.outline), data.out(s.triangulation));
+    });
+    graph.reads(s.outline);
+    graph.writes(s.triangulation);
+    graph.add("spine", [s](const TaskGraph::Data &data) {
+        extractSpine(data.in(s.triangulation), data.out(s.spine));
+    });
+    graph.reads(s.triangulation);
+    graph.writes(s.spine);
+    graph.add("pairs", [s](const TaskGraph::Data &data) {
+        vector<Pair> &pairs = data.out(s.pairs);
+        pairs.clear();
+        populateConnected(data.in(s.outline), pairs, data.out(s.last_in_shape));
+    });
+    graph.reads(s.outline);
+    graph.writes(s.pairs);
+    graph.writes(s.last_in_shape);
+
+    if (engine == ENGINE_IMPLICIT) {
+        graph.add("field", [s](const TaskGraph::Data &data) {
+            data.out(s.builder).reset();
+            if (!data.out(s.implicit).build(data.in(s.outline), IMPLICIT_RESOLUTION,
+                                            &thread_pool))
+                std::cerr << "IMPLICIT::OUTLINE::ENCLOSES NO GRID NODES" << std::endl;
+        });
+        graph.reads(s.outline);
+        graph.writes(s.implicit);
+        graph.writes(s.builder);
+        graph.add("polygonize", [s](const TaskGraph::Data &data) {
+            data.out(s.implicit).polygonize(data.out(s.verts), data.out(s.faces),
+                                            data.out(s.silhouette), &thread_pool);
+        });
+        graph.writes(s.implicit);
+        graph.writes(s.verts);
+        graph.writes(s.faces);
+        graph.writes(s.silhouette);
+    } else if (engine == ENGINE_HEIGHTFIELD) {
+        graph.add("raster", [s](const TaskGraph::Data &data) {
+            data.out(s.builder).reset();
+            if (!data.out(s.height).build(data.in(s.stroke), HEIGHTFIELD_RESOLUTION,
+                                          &thread_pool))
+                std::cerr << "HEIGHTFIELD::STROKE::COVERS NO PIXELS" << std::endl;
+        });
+        graph.reads(s.stroke);
+        graph.writes(s.height);
+        graph.writes(s.builder);
+        graph.add("extract", [s](const TaskGraph::Data &data) {
+            data.out(s.height).extract(data.out(s.verts), data.out(s.faces),
+                                       data.out(s.silhouette), &thread_pool);
+        });
+        graph.writes(s.height);
+        graph.writes(s.verts);
+        graph.writes(s.faces);
+        graph.writes(s.silhouette);
+    } else {
+        graph.add("rings", [s](const TaskGraph::Data &data) {
+            calculateVerticesDriver(data.in(s.spine), data.in(s.triangulation),
+                                    data.in(s.pairs), data.in(s.outline),
+                                    data.in(s.last_in_shape), data.in(s.circles),
+                                    data.out(s.builder), data.out(s.verts),
+                                    data.out(s.silhouette));
+        });
+        graph.reads(s.spine);
+        graph.reads(s.triangulation);
+        graph.reads(s.pairs);
+        graph.reads(s.outline);
+        graph.reads(s.last_in_shape);
+        graph.reads(s.circles);
+        graph.writes(s.builder);
+        graph.writes(s.verts);
+        graph.writes(s.silhouette);
+        graph.add("faces", [s](const TaskGraph::Data &data) {
+            populateMeshFaces(data.out(s.builder), data.in(s.verts), data.out(s.faces));
+        });
+        graph.reads(s.verts);
+        graph.writes(s.builder);
+        graph.writes(s.faces);
+    }
 
-    x1 = connected[index].p1->x();
-    x2 = connected[index].p2->x();
-    y1 = connected[index].p1->y();
-    y2 = connected[index].p2->y();
-    z1 = connected[index].p1->z();
-    z2 = connected[index].p2->z();
+    // Tubes meet at shared poles and junctions with coincident vertices
+    graph.add("weld", [s](const TaskGraph::Data &data) {
+        vector<Vector3f> &verts = data.out(s.verts);
+        weldVertices(verts, data.out(s.faces), weldDistance(verts), &data.out(s.arena),
+                     &data.out(s.silhouette));
+    });
+    graph.writes(s.verts);
+    graph.writes(s.faces);
+    graph.writes(s.silhouette);
+    graph.writes(s.arena);
+    return graph;
+}
 
-    xm = (x1 + x2) / 2;
-    ym = (y1 + y2) / 2;
-    zm = (z1 + z2) / 2;
+void bindSketch(GLint engine)
+{
+    TaskGraph &graph = meshGraph(engine);
+    const MeshSlots &s = mesh_slots[engine];
+
+    graph.bind(s.stroke, stroke);
+    graph.bind(s.outline, points_on_curve);
+    graph.bind(s.triangulation, triangulation);
+    graph.bind(s.spine, spine);
+    graph.bind(s.pairs, connected);
+    graph.bind(s.last_in_shape, last_in_shape);
+    graph.bind(s.circles, ring_circles);
+    graph.bind(s.builder, mesh_builder);
+    graph.bind(s.implicit, implicit_surface);
+    graph.bind(s.height, height_field);
+    graph.bind(s.verts, mesh_verts);
+    graph.bind(s.faces, mesh_faces);
+    graph.bind(s.silhouette, mesh_silhouette);
+    graph.bind(s.arena, sketch_arena);
+}
 
-    return (Vector3f(xm, ym, zm));
+GLboolean generateMesh(GLuint generation)
+{
+    TaskGraph &graph = meshGraph(inflation_engine);
+    for (GLuint s = 0; s < OUTLINE_STAGES; s++)
+        graph.enable(s, !triangulated);
+
+    bindSketch(inflation_engine);
+    if (!graph.run(&thread_pool, [generation]() { return mesh_jobs.cancelled(generation); }))
+        return GL_FALSE;
+    triangulated = 1;
+    return GL_TRUE;
 }
 
-void calculateVertices(GLint index, GLfloat theta)
+void shiftStroke(void)
 {
-    GLfloat x, y, z, a, b, c, u, v, w;
-    GLfloat newx=0, newy=0, newz=0;
-    Vector3f A = *(connected[index].p1);
-    Vector3f B = *(connected[index].p2);
-    Vector3f midpoint = calculateMidpoint(index);
-    Vector3f norm_dir = getNormal(A, B);
+    if (!stroke_shift_x && !stroke_shift_y) return;
 
-    x = A.x();
-    y = A.y();
-    z = A.z();
+    vector<Vector3f> &points = drawnStroke();
+    vector<Vector3f>::iterator v;
+    for (v = points.begin(); v != points.end(); v++) {
+        v->x() += stroke_shift_x;
+        v->y() += stroke_shift_y;
+    }
+    stroke_shift_x = 0;
+    stroke_shift_y = 0;
+}
 
-    a = midpoint.x();
-    b = midpoint.y();
-    c = midpoint.z();
+void publishMesh(void)
+{
+    mesh_pending = 0;
+    shiftStroke();
+    if (mesh_jobs.finished() != mesh_generation) return;
+
+    mesh_published = 1;
+    shown_verts.clear();
+    shown_faces.clear();
+    mesh_rest = mesh_verts;
+    mesh_version++;
+    fairMesh();
+    glutPostRedisplay();
+}
 
-    Vector3f point(a, y, z);
-    GLfloat opposite = distance(A, point);
-    GLfloat hypo     = distance(A, midpoint);
-    GLfloat angle    = asin(opposite / hypo);
+void finishMesh(void)
+{
+    if (!mesh_pending && !sketch_stale) return;
+    mesh_jobs.wait();
+    if (sketch_stale) {
+        clearSketch();
+        if (!mesh_pending) return;
+        mesh_published = 0;
+        mesh_generation = mesh_jobs.submit(generateMesh);
+        mesh_jobs.wait();
+    }
+    publishMesh();
+}
 
-	GLfloat r = sqrt(pow(B.x() - a, 2) + pow(B.y() - b, 2));
+void pollMesh(int value)
+{
+    mesh_polling = 0;
+    if (!mesh_pending && !sketch_stale) return;
 
-	//calculate circle points
-	newx = r * cos(theta);
-	newy = r * sin(theta);
+    if (mesh_jobs.busy()) {
+        mesh_polling = 1;
+        glutTimerFunc(MESH_POLL_MS, pollMesh, 0);
+        return;
+    }
+    if (sketch_stale) {
+        clearSketch();
+        if (mesh_pending) inflateSketch();
+        return;
+    }
+    publishMesh();
+}
+
+void togglePreview(void)
+{
+    previewing ^= 1;
+    printf("Live preview: %s\n", previewing ? "on" : "off");
+    if (previewing) {
+        // Once the worker is idle this thread may stand in as the consumer
+        preview_jobs.wait();
+        input_events.discard();
+        preview.points = drawnStroke();
+        if (!preview_polling) previewTick(0);
+    } else {
+        preview_jobs.cancel();
+        preview_sent = 0;
+    }
+    glutPostRedisplay();
+}
+
+void previewTick(int value)
+{
+    preview_polling = 0;
+    if (!previewing) return;
+
+    if (!preview_jobs.busy()) {
+        // A cancelled or empty build leaves the last preview up
+        if (preview_shown != preview_generation) {
+            if (preview_jobs.finished() == preview_generation) {
+                preview.publish();
+                glutPostRedisplay();
+            }
+            preview_shown = preview_generation;
+        }
+
+        // Strokes only grow until they are cleared, so a new size is a
+        // new stroke to preview
+        GLuint drawn = drawnStroke().size();
+        if (view.type == DRAWING && drawn >= PREVIEW_MIN_POINTS && drawn != preview_sent) {
+            preview_sent = drawn;
+            preview_generation = preview_jobs.submit([](GLuint generation) {
+                preview.drain(input_events);
+                preview.stroke = preview.points;
+                generateClosingPoints(preview.stroke);
+                return preview.build(preview_jobs, generation, &thread_pool);
+            });
+        }
+    }
+
+    // Tick while drawing, and until the last preview is published
+    if (tracking || preview_shown != preview_generation) {
+        preview_polling = 1;
+        glutTimerFunc(1000 / PREVIEW_RATE, previewTick, 0);
+    }
+}
+
+void drawPreview(void)
+{
+    if (!previewing || preview.faces.empty()) return;
+
+    GLint w = imageWidth * PREVIEW_FRACTION;
+    GLint h = imageHeight * PREVIEW_FRACTION;
+    GLint x = imageWidth - w;
 
-	//rotate around x axis
-    newz = newx;
-    GLfloat oldx = newx;
-    newx = 0.0f;
+    // Bottom right corner, on the 3D background
+    glViewport(x, 0, w, h);
+    glScissor(x, 0, w, h);
+    glEnable(GL_SCISSOR_TEST);
+    glClearColor(VIEW_RGBA_3D);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    glDisable(GL_SCISSOR_TEST);
 
-	//rotate around z axis
-	newx = newx*cos(angle) - newy*sin(angle);
-	newy = newx*sin(angle) + newy*cos(angle);
+    if (preview_drawn != preview.published) {
+        preview_mesh.build(preview.verts.size(), preview.faces);
+        preview_mesh.update(preview.verts);
+        preview_drawn = preview.published;
+    }
 
-	// //translate circle to place.
-	newx = newx+a;
-	newy = newy+b;
+    // Frame the bounds of the preview as the mesh draws it
+    GLfloat s = preview_mesh.scale;
+    GLfloat r = s * preview.radius + 1.0f;
+    GLfloat aspect = (GLfloat)w / h;
+    glMatrixMode(GL_PROJECTION);
+    glPushMatrix();
+    glLoadIdentity();
+    glOrtho(-r * aspect, r * aspect, -r, r, -r, r);
+    glMatrixMode(GL_MODELVIEW);
+    glPushMatrix();
+    glLoadIdentity();
+
+    enableLighting();
+    glColor3f(RGBWHITE);
+    glRotatef(PREVIEW_TURN, 0.0f, 1.0f, 0.0f);
+    glTranslatef(-s * preview.center.x(), -s * preview.center.y(), -s * preview.center.z());
+    preview_mesh.draw(preview.verts);
+    disableLighting();
+
+    glPopMatrix();
+    glMatrixMode(GL_PROJECTION);
+    glPopMatrix();
+    glMatrixMode(GL_MODELVIEW);
+    glViewport(0, 0, imageWidth, imageHeight);
+}
 
-    //push directly into the vector to save it.
-    mesh_verts.push_back(Vector3f(newx, newy, newz));
+void fairMesh(void)
+{
+    if (objLoaded || mesh_rest.size() != mesh_verts.size()) return;
+
+    if (!fairing_mode)
+        mesh_verts = mesh_rest;
+    else if (!fairing.fair(mesh_rest, mesh_faces, mesh_silhouette, fairing_weight,
+                           (FairingWeights)(fairing_mode - 1), mesh_verts))
+        std::cerr << "FAIRING::SYSTEM::FACTORIZATION FAILED" << std::endl;
+    verts_version++;
+
+    if (optimizing) {
+        mesh_adjacency.update(mesh_version, mesh_verts.size(), mesh_faces, &thread_pool);
+        optimizer.begin(mesh_verts, mesh_faces, mesh_silhouette, mesh_adjacency);
+        glutIdleFunc(optimizeIdle);
+    }
 }
 
-void populateConnected()
+void cycleFairing(void)
 {
-    if (points_on_curve.size() == 0) return;
-	//sets the original size to iterate over
-	go_back_for.push_back(1);
-	go_back_for.push_back(points_on_curve.size()-1);
+    fairing_mode = (fairing_mode + 1) % NUM_FAIRING_MODES;
+    printf("Fairing: %s\n", FAIRING_NAMES[fairing_mode]);
+    fairMesh();
+    glutPostRedisplay();
+}
+
+void scaleFairingWeight(GLfloat factor)
+{
+    fairing_weight = std::min(std::max(fairing_weight * factor, 1.0f / 64), 64.0f);
+    printf("Fairing weight: %g\n", fairing_weight);
+    if (!fairing_mode) return;
+    fairMesh();
+    glutPostRedisplay();
+}
 
-	//iterates over the vector, populates the connected vector
-	iterateThrough(go_back_for[0], go_back_for[1]);
+void cycleInflationEngine(void)
+{
+    inflation_engine = (inflation_engine + 1) % NUM_ENGINES;
+    printf("Inflation engine: %s\n", ENGINE_NAMES[inflation_engine]);
+
+    if (objLoaded || !triangulated || view.type != VIEWING) return;
+    inflateSketch();
+    glutPostRedisplay();
+}
+
+Pair::Pair(const vector<Vector3f> &points, GLuint i, GLuint j)
+    : first(i), second(j)
+{
+    Vector2f a = points[i].head<2>(), b = points[j].head<2>();
+    Vector2f chord = a - b;
+
+    midpoint   = (a + b) / 2;
+    half_width = chord.norm() / 2;
+    direction  = chord.normalized();
+}
+
+void populateConnected(const vector<Vector3f> &outline, vector<Pair> &pairs,
+                       Vector3f &last)
+{
+    if (outline.size() == 0) return;
+	//iterates over the whole outline, populates the pairs vector
+	iterateThrough(outline, 1, outline.size()-1, pairs, last);
 }
 
-void iterateThrough(GLint count_forward, GLint count_back)
+void iterateThrough(const vector<Vector3f> &outline, GLint count_forward, GLint count_back,
+                    vector<Pair> &pairs, Vector3f &last)
 {
 	// counter to find which to increment next
 	GLint is_for_or_back = 0;
@@ -291,46 +744,46 @@ void iterateThrough(GLint count_forward, GLint count_back)
 		if (is_for_or_back == 0) {
 			is_for_or_back = 1;
 			// finds the corresponding points
-			GLint ret = checkPoints_CountForward(count_forward, count_back);
+			GLint ret = checkPoints_CountForward(outline, count_forward, count_back, pairs);
 			// accounts for if indexes were skipped
 			count_forward++;
 		} else {
 			is_for_or_back = 0;
 			// finds corresponding points
-			GLint ret = checkPoints_CountBack(count_back, count_forward);
+			GLint ret = checkPoints_CountBack(outline, count_back, count_forward, pairs);
 			// accounts for it indees were skipped
 			count_back--;
 		}
 	}
-    last_in_shape = *(connected[connected.size()-1].p2);
-    connected.pop_back();
+    last = outline[pairs.back().second];
+    pairs.pop_back();
 }
 
-GLint checkPoints_CountForward(GLint index1, GLint index2)
+GLint checkPoints_CountForward(const vector<Vector3f> &outline, GLint index1, GLint index2,
+                               vector<Pair> &pairs)
 {
-	Vector3f a = points_on_curve[index1 - 1];
-	Vector3f b = points_on_curve[index1];
-	Vector3f c = points_on_curve[index1 + 1];
+	Vector3f a = outline[index1 - 1];
+	Vector3f b = outline[index1];
+	Vector3f c = outline[index1 + 1];
 
 	Vector3f ab = getNormal(a, b);
 	Vector3f bc = getNormal(b, c);
 
-    connected.push_back(Line(points_on_curve[index1], points_on_curve[index2]));
-    recent = 0;
+    pairs.push_back(Pair(outline, index1, index2));
 	return 0;
 }
 
-GLint checkPoints_CountBack(GLint index1, GLint index2)
+GLint checkPoints_CountBack(const vector<Vector3f> &outline, GLint index1, GLint index2,
+                            vector<Pair> &pairs)
 {
-	Vector3f a = points_on_curve[index1 + 1];
-	Vector3f b = points_on_curve[index1];
-	Vector3f c = points_on_curve[index1 - 1];
+	Vector3f a = outline[index1 + 1];
+	Vector3f b = outline[index1];
+	Vector3f c = outline[index1 - 1];
 
 	Vector3f ab = getNormal(a, b);
 	Vector3f bc = getNormal(b, c);
 
-    connected.push_back(Line(points_on_curve[index1], points_on_curve[index2]));
-    recent = 0;
+    pairs.push_back(Pair(outline, index1, index2));
 	return 0;
 }
 
@@ -346,9 +799,11 @@ void generateClosingPoints(vector<Vector3f> &points)
 {
     GLfloat t, delta, cx, cy;
 
+    if (points.empty()) return;
+
     // interpolate vertices from Endpoint to Startpoint
-    Vector3f a = stroke.back();
-    Vector3f b = stroke.front();
+    Vector3f a = points.back();
+    Vector3f b = points.front();
 
     GLfloat length = sideLength(a, b);
 
@@ -356,8 +811,7 @@ void generateClosingPoints(vector<Vector3f> &points)
     t = 0.0; delta = 1/(length/12);
     for (t = 0.0; t <= 1.0; t += delta) {
         cx = (1.0 - t) * a.x() + t * b.x();
-        cy = (a.y() + (b.y() - a.y()) *
-            ((cx - a.x()) / (b.x() - a.x())));
+        cy = (1.0 - t) * a.y() + t * b.y();
 
         // add interpolated point to stroke
         points.push_back(Vector3f(cx, cy, 0));
@@ -374,23 +828,23 @@ GLfloat calcAngle(GLfloat BA, GLfloat BC, GLfloat AC)
 	return acos((pow(BA, 2) + pow(BC, 2) - pow(AC, 2))/(2 * BA * BC));
 }
 
-GLint findNextPoint(GLint i, GLint distance)
+GLint findNextPoint(const vector<Vector3f> &points, GLint i, GLint distance)
 {
 	//base case, if the distance exceeds the bounds
-	if (i+distance > stroke.size() && distance % 2 == 0) {
-		return findNextPoint(i, distance/2);
+	if (i+distance > points.size() && distance % 2 == 0) {
+		return findNextPoint(points, i, distance/2);
 	//if the distance does not exceed the bounds but the distance cannot be divided by 2
-	} else if (distance % 2 != 0 && i+distance <= stroke.size()) {
+	} else if (distance % 2 != 0 && i+distance <= points.size()) {
 		return i+distance;
 	//if the distance cannot be divided by 2 and the distance exceeds bounds
-	} else if (distance % 2 != 0 && i+distance > stroke.size()) {
-		return stroke.size();
+	} else if (distance % 2 != 0 && i+distance > points.size()) {
+		return points.size();
 	//if everything is okay
 	} else {
 		//get three points
-		Vector3f a = stroke[i];
-		Vector3f b = stroke[i+(distance/2)];
-		Vector3f c = stroke[i+distance];
+		Vector3f a = points[i];
+		Vector3f b = points[i+(distance/2)];
+		Vector3f c = points[i+distance];
 		//find distance between each point around triangle
 		GLfloat ba = sideLength(b, a);
 		GLfloat bc = sideLength(b, c);
@@ -398,7 +852,7 @@ GLint findNextPoint(GLint i, GLint distance)
 
 		//if the angle isnt what we want, try again with a shorter distance
 		if (calcAngle(ba, bc, ac) > VERTEX_LIMIT) {
-			return findNextPoint(i, (distance/2));
+			return findNextPoint(points, i, (distance/2));
 
 		//if it is what we want, return this distance
 		} else {
@@ -407,25 +861,40 @@ GLint findNextPoint(GLint i, GLint distance)
 	}
 }
 
-void getOutsideEdges()
+void getOutsideEdges(const vector<Vector3f> &points, vector<Vector3f> &outline)
 {
-    if (stroke.size() == 0) return;
+    if (points.size() == 0) return;
 	//takes first point of stroke and puts it in vector
-	points_on_curve.push_back(stroke[0]);
+	outline.push_back(points[0]);
 	//sets the counter variable
 	GLint count = 0;
 	//loop through each vertex in stroke
-	for (GLuint i = 0; i < stroke.size()-1; i += (count - i)) {
+	for (GLuint i = 0; i < points.size()-1; i += (count - i)) {
 		//find the next point for the curve
-		count = findNextPoint(i, DISTANCE_BETWEEN_POINTS);
+		count = findNextPoint(points, i, DISTANCE_BETWEEN_POINTS);
 		//add to the vector
-        if (stroke[count].x() != 0 && stroke[count].y() != 0) {
-		    points_on_curve.push_back(stroke[count]);
+        if (points[count].x() != 0 && points[count].y() != 0) {
+		    outline.push_back(points[count]);
         }
 	}
 	return;
 }
 
+void triangulateOutline(const vector<Vector3f> &outline, Triangulation &tri)
+{
+    if (outline.size() < 3) return;
+    tri.triangulate(outline);
+    if (tri.failed_constraints)
+        std::cerr << "TRIANGULATION::OUTLINE::"
+                  << tri.failed_constraints
+                  << " UNRECOVERED EDGES" << std::endl;
+}
+
+void extractSpine(const Triangulation &tri, Spine &axis)
+{
+    axis.build(tri);
+}
+
 void transition_2D(void)
 {
     if (view.type == DRAWING) return;
@@ -448,14 +917,8 @@ void transition_3D(void)
     view.setRGBA(VIEW_RGBA_3D);
 
     /* launch 3D mesh creation if a stroke is given */
-    if (stroke.size()) {
-        if (!triangulated) {
-            getOutsideEdges();
-            populateConnected();
-            calculateVerticesDriver();
-        }
-        populateMeshFaces();
-    }
+    if (drawnStroke().size())
+        inflateSketch();
 
     glutReshapeWindow(imageWidth, imageHeight);
     glutPostRedisplay();
@@ -470,7 +933,6 @@ void display(void)
     glEnable(GL_DEPTH_TEST);
 
     vector<Vector3f>::const_iterator v;
-    vector<Line>::const_iterator l;
 
     if (view.type == DRAWING) {
         glColor3f(RGBBLACK);
@@ -479,22 +941,42 @@ void display(void)
 
         // Draw user stroke's vertices
         glBegin(GL_LINE_LOOP);
-        for (v = stroke.begin(); v != stroke.end(); v++) {
+        for (v = drawnStroke().begin(); v != drawnStroke().end(); v++) {
             glVertex2f(v->x(), v->y());
         }
         glEnd();
 
-        // Draw mesh triangles
-        if (display_triangles) {
-    		glBegin(GL_LINES);
-    		for (l = connected.begin(); l != connected.end(); l++) {
-    			glVertex2f(l->p1->x(), l->p1->y());
-    			glVertex2f(l->p2->x(), l->p2->y());
-    		}
-    		glEnd();
+        // Draw mesh triangles, unless a mesh job is still building them
+        if (display_triangles && !mesh_pending && !sketch_stale) {
+            glBegin(GL_LINES);
+            for (GLuint t = 0; t < triangulation.size(); t++) {
+                for (GLuint i = 0; i < 3; i++) {
+                    // Draw shared edges once
+                    GLint n = triangulation.neighbors[3*t + i];
+                    if (n >= 0 && (GLuint)n < t) continue;
+                    Vector2f &a = triangulation.points[triangulation.vertex(t, i)];
+                    Vector2f &b = triangulation.points[triangulation.vertex(t, (i+1) % 3)];
+                    glVertex2f(a.x(), a.y());
+                    glVertex2f(b.x(), b.y());
+                }
+            }
+            glEnd();
+
+            // Draw chordal axis
+            glColor3f(RGBWHITE);
+            glBegin(GL_LINES);
+            for (GLuint e = 0; e < spine.edges.size(); e++) {
+                Vector2f &p = spine.nodes[spine.edges[e]];
+                glVertex2f(p.x(), p.y());
+            }
+            glEnd();
+            glColor3f(RGBBLACK);
+
+            // A running mesh job is still writing mesh_verts
+            vector<Vector3f> &ring_verts = mesh_pending ? shown_verts : mesh_verts;
     		glPointSize(5);
     		glBegin(GL_POINTS);
-            for (v = mesh_verts.begin(); v != mesh_verts.end(); v++) {
+            for (v = ring_verts.begin(); v != ring_verts.end(); v++) {
                 glVertex2f(v->x(), v->y());
             }
     		for (v = points_on_curve.begin(); v != points_on_curve.end(); v++) {
@@ -503,6 +985,8 @@ void display(void)
     		glEnd();
     	}
 
+        drawPreview();
+
     } else if (view.type == VIEWING) {
         glColor3f(RGBWHITE);
 
@@ -515,26 +999,64 @@ void display(void)
         else
             disableLighting();
 
+        // While a mesh job runs, the last finished mesh stands in for it;
+        // the first mesh of a sketch shows its outline until it is ready
+        vector<Vector3f> *draw_verts = mesh_pending ? &shown_verts : &mesh_verts;
+        vector<Triangle> *draw_faces = mesh_pending ? &shown_faces : &mesh_faces;
+        vector<Vector3f> &base_verts = *draw_verts;
+        vector<Triangle> &base_faces = *draw_faces;
+        if (mesh_pending && base_faces.empty()) {
+            glBegin(GL_LINE_LOOP);
+            for (v = drawnStroke().begin(); v != drawnStroke().end(); v++)
+                glVertex3f(v->x(), v->y(), 0.0f);
+            glEnd();
+        }
+
         if (test_mesh_pts) {
             glPointSize(3);
             glBegin(GL_POINTS);
-            for (v = mesh_verts.begin(); v != mesh_verts.end(); v++) {
+            for (v = base_verts.begin(); v != base_verts.end(); v++) {
                 glVertex3f(v->x(), v->y(), v->z());
             }
             glEnd();
         }
 
-        Mesh object(mesh_verts, mesh_faces);
+        // The draw buffers are rebuilt when the shown faces change and
+        // refreshed when its vertices move, not on every redraw
+        GLboolean rebuild = drawn_faces != mesh_version || drawn_level != subdivision_level ||
+                            drawn_pending != mesh_pending;
+        if (rebuild || drawn_verts != verts_version) {
+            drawn_subdivided = 0;
+            if (subdivision_level && base_faces.size()) {
+                if (rebuild)
+                    subdivider.build(base_verts.size(), base_faces, subdivision_level);
+                drawn_subdivided = subdivider.evaluate(base_verts, &thread_pool);
+            }
+            if (drawn_subdivided) {
+                draw_verts = &subdivider.verts;
+                draw_faces = &subdivider.faces;
+            }
+            if (rebuild)
+                render_mesh.build(draw_verts->size(), *draw_faces);
+            render_mesh.update(*draw_verts);
+
+            drawn_faces   = mesh_version;
+            drawn_verts   = verts_version;
+            drawn_level   = subdivision_level;
+            drawn_pending = mesh_pending;
+        } else if (drawn_subdivided) {
+            draw_verts = &subdivider.verts;
+        }
 
         // FIXME: NASTY HACK BECAUSE THE OBJ FILE HAS ORIGIN AT CENTER
         // INSTEAD OF (0,0)
         if (objLoaded) {
             glPushMatrix();
             glTranslatef(imageWidth/2, imageHeight/2, 0.0f);
-            object.draw();
+            render_mesh.draw(*draw_verts);
             glPopMatrix();
         } else {
-            object.draw();
+            render_mesh.draw(*draw_verts);
         }
 
         glPopMatrix();
@@ -552,7 +1074,6 @@ void reshape(int w, int h)
     GLint deltaH  = (h - imageHeight) / 2;
     imageWidth  = w;
     imageHeight = h;
-    vector<Vector3f>::iterator v;
 
     // Force window to maintain minimum size
     if (w < IMAGE_WIDTH && h < IMAGE_HEIGHT)
@@ -562,11 +1083,11 @@ void reshape(int w, int h)
     else if (h < IMAGE_HEIGHT)
         glutReshapeWindow(w, IMAGE_HEIGHT);
 
-    // Update stroke vertices to keep stroke centered
-    for (v = stroke.begin(); v != stroke.end(); v++) {
-        v->x() += deltaW;
-        v->y() += deltaH;
-    }
+    // Keep the stroke centered; a mesh job may be reading it, in which
+    // case it moves once the job is published
+    stroke_shift_x += deltaW;
+    stroke_shift_y += deltaH;
+    if (!mesh_pending) shiftStroke();
 
     // Update bounding box parameters
     view.setProjection(0.0f, imageWidth, 0.0f, imageHeight, view.near, view.far);
@@ -629,18 +1150,21 @@ void mouse(int button, int state, int x, int y)
                 if (!tracking) {
                     resetStroke();
                     tracking = 1;
+                    if (previewing) input_events.push(INPUT_DOWN, x, y);
+                    if (previewing && !preview_polling) previewTick(0);
                 }
                 // Update coordinates
                 previousX = x;
                 previousY = y;
             }
-        } else if (button == GLUT_LEFT_BUTTON && state == GLUT_UP) {
-            // stroke complete
+        } else if (button == GLUT_LEFT_BUTTON && state == GLUT_UP && tracking) {
+            // stroke complete; a release without a press is ignored
+            if (previewing) input_events.push(INPUT_UP, x, y);
             tracking = 0;
             previousX = 0;
             previousY = 0;
             // get start & end connecting vertices
-            generateClosingPoints(stroke);
+            generateClosingPoints(drawnStroke());
             // redraw stroke
             glutPostRedisplay();
         }
@@ -655,6 +1179,7 @@ void mouseMotion(int x, int y)
     if (view.type == VIEWING) {
         trackball.mouse_motion(x, -y);
         glutPostRedisplay();
+        return;
     }
 
     // Only record point if the distance between the new point and the last
@@ -665,7 +1190,8 @@ void mouseMotion(int x, int y)
 
     if (tracking && inWindow(x, y)) {
         // push vertex into vector
-        stroke.push_back(Vector3f(x, y, 0));
+        drawnStroke().push_back(Vector3f(x, y, 0));
+        if (previewing) input_events.push(INPUT_MOTION, x, y);
 
         glBegin(GL_LINES);
             glVertex2f(previousX, previousY);
@@ -694,11 +1220,26 @@ GLboolean loadUserFile(void)
 
     // loadObj returns true if the file was successfully loaded,
     // or false otherwise.
-    return (loadObj(fname, mesh_verts, mesh_faces));
+    GLboolean loaded = loadObj(fname, mesh_verts, mesh_faces);
+    if (loaded) {
+        GLuint welded = weldVertices(mesh_verts, mesh_faces, weldDistance(mesh_verts),
+                                     &sketch_arena);
+        if (welded) printf("Welded %u duplicate vertices\n", welded);
+    }
+    mesh_published = loaded;
+    mesh_version++;
+    verts_version++;
+    return loaded;
 }
 
 void keyboard(unsigned char key, int x, int y)
 {
+    // Only view keys may run while a mesh job owns the sketch; '3' and
+    // 'c' start or cancel jobs themselves
+    if (key != 27 && key != 50 && key != 51 && key != 99 && key != 108 &&
+        key != 112 && key != 115 && key != 118)
+        finishMesh();
+
     switch (key) {
     case 27: // escape key
         exit(0);
@@ -717,21 +1258,58 @@ void keyboard(unsigned char key, int x, int y)
         objLoaded = 1;
         transition_3D();
         break;
+    case 97: // 'a' toggle adaptive ring resolution
+        toggleAdaptiveRings();
+        break;
+    case 101: // 'e' cycle inflation engine
+        cycleInflationEngine();
+        break;
     case 99: // 'c' to clear the stroke
         objLoaded = 0;
         resetStroke();
         break;
+    case 102: // 'f' cycle mesh fairing
+        cycleFairing();
+        break;
+    case 91: // '[' lower the fairing weight
+        scaleFairingWeight(0.5f);
+        break;
+    case 93: // ']' raise the fairing weight
+        scaleFairingWeight(2.0f);
+        break;
+    case 111: // 'o' toggle the surface optimizer
+        toggleOptimizer();
+        break;
+    case 112: // 'p' toggle the live preview
+        togglePreview();
+        break;
+    case 114: // 'r' remesh the viewed mesh
+        remeshMesh();
+        break;
+    case 115: // 's' cycle subdivision levels
+        cycleSubdivision();
+        break;
+    case 105: // 'i' print memory counters and stage timings
+        printStats();
+        break;
     case 108: // 'l' for lighting
         view.light = (view.light == ON) ? OFF : ON;
         glutPostRedisplay();
         break;
+    case 113: // 'q' cycle ring quality
+        cycleRingPreset();
+        break;
     case 116: // 't' toggle triangulation
         display_triangles ^= 1;
         if (!triangulated) {
             triangulated = 1;
-            getOutsideEdges();
-            populateConnected();
-            calculateVerticesDriver();
+            getOutsideEdges(stroke, points_on_curve);
+            triangulateOutline(points_on_curve, triangulation);
+            extractSpine(triangulation, spine);
+            populateConnected(points_on_curve, connected, last_in_shape);
+            calculateVerticesDriver(spine, triangulation, connected, points_on_curve,
+                                    last_in_shape, ring_circles, mesh_builder,
+                                    mesh_verts, mesh_silhouette);
         }
         glutPostRedisplay();
         break;
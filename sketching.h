@@ -20,12 +20,30 @@
 #include <iostream>
 #include <string>
 #include <cmath>
+#include <algorithm>
 #include <vector>
 #include <Eigen/Dense>
 #include "view.h"
 #include "trackball.h"
 #include "mesh.h"
 #include "objIO.h"
+#include "triangulation.h"
+#include "spine.h"
+#include "inflation.h"
+#include "meshbuilder.h"
+#include "implicit.h"
+#include "heightfield.h"
+#include "fairing.h"
+#include "optimizer.h"
+#include "remesh.h"
+#include "subdivision.h"
+#include "adjacency.h"
+#include "spatialhash.h"
+#include "rendermesh.h"
+#include "scratch.h"
+#include "background.h"
+#include "preview.h"
+#include "taskgraph.h"
 
 using namespace Eigen;
 using std::vector;
@@ -61,8 +79,6 @@ static GLint DISTANCE_CONSTANT = 50;
 
 /********** GLOBAL VARIABLES ***************/
 const GLdouble PI = 3.141592653589793238462643383279502884197;
-const GLint mesh_rotation = 6;
-const GLint numCirclePts = 360 / mesh_rotation;
 
 View view;
 
@@ -71,31 +87,118 @@ static GLint imageWidth, imageHeight;     // window pixel dimensions
 static GLint previousX, previousY;        // previous (x,y) for stroke tracking
 static GLint display_triangles = 0;
 static GLint triangulated = 0;
+static GLuint ring_preset = 2;            // RING_PRESETS entry, 60 segments
+static GLint adaptive_rings = 1;          // size rings by radius
+static GLint inflation_engine = 0;        // InflationEngine used at transition_3D
+static GLfloat ring_tolerance = 0.5;      // max ring chord error in pixels
+static GLint fairing_mode = 0;            // 0 off, else FairingWeights + 1
+static GLfloat fairing_weight = 1.0;      // Laplacian weight of the fairing step
+static GLint optimizing = 0;              // run the surface optimizer when idle
+static GLfloat optimize_budget = 8.0;     // optimizer milliseconds per frame
+static GLuint subdivision_level = 0;      // Loop levels drawn over the mesh
+static GLuint drawn_faces = ~0u;          // mesh_version the draw buffers were built for
+static GLuint drawn_verts = ~0u;          // verts_version they were last refreshed for
+static GLuint drawn_level = 0;            // subdivision_level they were built for
+static GLint drawn_pending = 0;           // mesh_pending they were built for
+static GLint drawn_subdivided = 0;        // they hold subdivided positions
+static GLint mesh_pending = 0;            // a mesh job is queued, running or unpublished
+static GLint mesh_published = 0;          // mesh_verts and mesh_faces hold a finished mesh
+static GLint sketch_stale = 0;            // a cancelled mesh job may still hold the old sketch
+static GLuint mesh_generation = 0;        // generation of the newest mesh job
+static GLint mesh_polling = 0;            // pollMesh timer armed
+static GLint stroke_shift_x = 0;          // window resize offset the stroke still owes
+static GLint stroke_shift_y = 0;
+const GLuint MESH_POLL_MS = 15;           // pollMesh timer period
+const GLuint OUTLINE_STAGES = 4;          // leading stages of every mesh graph
+static GLint previewing = 0;              // build live previews while drawing
+static GLuint preview_generation = 0;     // generation of the newest preview job
+static GLuint preview_shown = 0;          // generation of the published preview
+static GLuint preview_sent = 0;           // stroke size the newest preview was built from
+static GLint preview_polling = 0;         // previewTick timer armed
+static GLuint preview_drawn = 0;          // preview.published the preview buffers hold
+const GLuint PREVIEW_RATE = 10;           // most preview builds per second
+const GLuint PREVIEW_MIN_POINTS = 8;      // stroke samples before the first preview
+const GLfloat PREVIEW_FRACTION = 0.3f;    // side viewport size relative to the window
+const GLfloat PREVIEW_TURN = 30.0f;       // degrees the preview turns about the vertical
+
+enum InflationEngine { ENGINE_TUBES, ENGINE_IMPLICIT, ENGINE_HEIGHTFIELD, NUM_ENGINES };
+static const char *ENGINE_NAMES[NUM_ENGINES] = { "tubes", "implicit", "height field" };
+
+const GLint NUM_FAIRING_MODES = 3;
+static const char *FAIRING_NAMES[NUM_FAIRING_MODES] = { "off", "uniform", "cotangent" };
 
-struct Line {
-    Vector3f *p1;
-    Vector3f *p2;
-
-    Line():p1(NULL), p2(NULL) {}
-    Line(Vector3f &v1, Vector3f &v2)
-    : p1(&v1), p2(&v2) {}
+/**
+ * Pair struct
+ * Two points_on_curve indices across the shape from each other, with the
+ * ring their chord spans: its midpoint, half its length and its unit
+ * direction from the second point to the first.
+ */
+struct Pair {
+    Vector2f midpoint;
+    Vector2f direction;
+    GLfloat  half_width;
+    GLuint   first, second;
+
+    Pair(void) : half_width(0.0f), first(0), second(0) {}
+    Pair(const vector<Vector3f> &points, GLuint i, GLuint j);
 };
 
-struct Circle {
-    vector<GLuint> verts;
+/**
+ * MeshSlots struct
+ * The data the stages of one mesh graph read and write, declared by
+ * meshGraph and bound to a sketch by bindSketch.
+ */
+struct MeshSlots {
+    TaskGraph::Slot<vector<Vector3f> > stroke, outline;
+    TaskGraph::Slot<Triangulation>     triangulation;
+    TaskGraph::Slot<Spine>             spine;
+    TaskGraph::Slot<vector<Pair> >     pairs;
+    TaskGraph::Slot<Vector3f>          last_in_shape;
+    TaskGraph::Slot<CircleCache>       circles;
+    TaskGraph::Slot<MeshBuilder>       builder;
+    TaskGraph::Slot<ImplicitSurface>   implicit;
+    TaskGraph::Slot<HeightField>       height;
+    TaskGraph::Slot<vector<Vector3f> > verts;
+    TaskGraph::Slot<vector<Triangle> > faces;
+    TaskGraph::Slot<vector<GLuint> >   silhouette;
+    TaskGraph::Slot<Arena>             arena;
 };
 
 vector<Vector3f> stroke;            // stroke vertices
+vector<Vector3f> stroke_ahead;      // stroke drawn while the old sketch is stale
 vector<Vector3f> points_on_curve;   // significant stroke vertices
-vector<GLint> go_back_for;			// list of points to redraw
-vector<Line> connected;             // list of connected vertices
-vector<Circle> mesh_circles;        // interpolated 3D geometry
+vector<Pair> connected;             // pairs of points across the shape
+MeshBuilder mesh_builder;           // rings and tubes of the inflated mesh
+ImplicitSurface implicit_surface;   // field of the implicit engine
+HeightField height_field;           // raster of the height field engine
+Fairing fairing;                    // cached factorization of the fairing step
+SurfaceOptimizer optimizer;         // curvature optimizer of the viewed mesh
+Remesher remesher;                  // isotropic remesher of the viewed mesh
+Subdivider subdivider;              // cached Loop stencils of the viewed mesh
+RenderMesh render_mesh;             // index buffers of the drawn mesh
+RenderMesh preview_mesh;            // index buffers of the drawn preview
+Arena sketch_arena;                 // scratch of the current sketch
+CircleCache ring_circles;           // angular samples per ring size
+ThreadPool thread_pool;             // workers shared by the mesh stages
 vector<GLint> check_verts;          // indices of vertices to check
 vector<Vector3f> mesh_verts;        // mesh vertices
+vector<Vector3f> mesh_rest;         // inflated vertices before fairing
 vector<Triangle> mesh_faces;        // mesh faces
+vector<GLuint> mesh_silhouette;     // mesh vertices on the sketched outline
+GLuint mesh_version = 0;            // bumped whenever mesh_faces change
+GLuint verts_version = 0;           // bumped whenever mesh_verts move
+Adjacency mesh_adjacency;           // faces and neighbors per mesh vertex
+Triangulation triangulation;        // constrained Delaunay triangulation
+Spine spine;                        // pruned chordal axis of triangulation
 Vector3f last_in_shape;
-
-static GLint recent;		//global variable used in calculating
+vector<Vector3f> shown_verts;       // last finished mesh, drawn while the next builds
+vector<Triangle> shown_faces;
+TaskGraph mesh_graphs[NUM_ENGINES]; // stages of generateMesh per engine
+MeshSlots mesh_slots[NUM_ENGINES];  // slots of each graph in mesh_graphs
+Preview preview;                    // coarse mesh of the stroke being drawn
+EventQueue input_events;            // mouse events from GLUT to the preview worker
+Background mesh_jobs;               // builds meshes off the GLUT thread; declared
+Background preview_jobs;            // last so they stop before the rest is destroyed
 
 /*********************************************/
 
@@ -131,49 +234,265 @@ void wipeCanvas(void);
 
 /**
  * resetStroke
- * Destroys stored stroke vertices and resets the canvas.
+ * Destroys stored stroke vertices and resets the canvas. Running jobs are
+ * cancelled but not waited for; while the mesh job still holds the old
+ * sketch, the new stroke is drawn into stroke_ahead.
  */
 void resetStroke(void);
 
+/**
+ * clearSketch
+ * Clears the data the mesh job builds from and into, and makes
+ * stroke_ahead the stroke. Runs only while no mesh job does.
+ */
+void clearSketch(void);
+
+/**
+ * drawnStroke
+ * @return vector<Vector3f> & - the stroke input goes to: stroke_ahead
+ * while the old sketch is stale, stroke otherwise
+ */
+vector<Vector3f> &drawnStroke(void);
+
 /*****************************************/
 /* INTERPOLATION *************************/
 
 /**
  * populateMeshFaces
- * Populates the mesh_faces vector with instances of Triangle, detailing
- * which vertices form triangle faces on the mesh.
+ * @param MeshBuilder &builder - rings inflated into verts
+ * @param vector<Vector3f> &verts - the inflated vertices
+ * @param vector<Triangle> &faces - receives the faces
+ * Populates faces with instances of Triangle, detailing which vertices
+ * form triangle faces on the mesh.
+ * @return NONE
  */
-void populateMeshFaces(void);
+void populateMeshFaces(MeshBuilder &builder, const vector<Vector3f> &verts,
+                       vector<Triangle> &faces);
 
 /**
  * calculateVerticesDriver
+ * @param Spine &spine, Triangulation &tri - chordal axis of the outline
+ * @param vector<Pair> &pairs, vector<Vector3f> &outline, Vector3f &last -
+ *        chords across the outline, used when there is no spine
+ * @param CircleCache &circles - angular samples per ring size
+ * @param MeshBuilder &builder - receives the rings
+ * @param vector<Vector3f> &verts - receives the inflated vertices
+ * @param vector<GLuint> &silhouette - receives the vertices on the outline
+ * computes one ring per spine node (or per connected pair when there is no
+ * spine) and inflates all of them in one batch
+ * @return NONE
+ */
+void calculateVerticesDriver(const Spine &spine, const Triangulation &tri,
+                             const vector<Pair> &pairs, const vector<Vector3f> &outline,
+                             const Vector3f &last, const CircleCache &circles,
+                             MeshBuilder &builder, vector<Vector3f> &verts,
+                             vector<GLuint> &silhouette);
+
+/**
+ * ringsFromConnected
+ * @param vector<Pair> &pairs - chords across the outline
+ * @param vector<Vector3f> &outline - the outline the chords index
+ * @param Vector3f &last - the tube's tail
+ * @param MeshBuilder &builder - receives the tube
+ * builds a single tube of rings from pairs
+ * @return NONE
+ */
+void ringsFromConnected(const vector<Pair> &pairs, const vector<Vector3f> &outline,
+                        const Vector3f &last, MeshBuilder &builder);
+
+/**
+ * cycleRingPreset
+ * @param NONE
+ * switches rings to the next quality preset and rebuilds the current mesh;
+ * with adaptive rings the preset is the largest segment count allowed
+ * @return NONE
+ */
+void cycleRingPreset(void);
+
+/**
+ * toggleAdaptiveRings
+ * @param NONE
+ * switches between radius-adaptive and uniform ring resolution
+ * @return NONE
+ */
+void toggleAdaptiveRings(void);
+
+/**
+ * inflateSketch
+ * @param NONE
+ * starts building the mesh of the current sketch with the selected
+ * inflation engine on the background thread; the last finished mesh moves
+ * to shown_verts and shown_faces and is drawn until the new one is ready.
+ * Only a published mesh moves; the arrays of any other are half built.
+ * While the old sketch is stale the job is left for pollMesh to submit
+ * @return NONE
+ */
+void inflateSketch(void);
+
+/**
+ * meshGraph
+ * @param GLint engine - the inflation engine to build with
+ * builds the stages of generateMesh for engine on first use: the
+ * OUTLINE_STAGES outline stages, then the engine's stages and the weld.
+ * Stages work only on their slots in mesh_slots, so stages on disjoint data
+ * overlap, such as the spine with the chord pairs, or the implicit field
+ * and height raster with the whole outline
+ * @return TaskGraph & - the engine's graph in mesh_graphs
+ */
+TaskGraph &meshGraph(GLint engine);
+
+/**
+ * bindSketch
+ * @param GLint engine - the inflation engine to build with
+ * binds the slots of the engine's graph to the data of the current sketch
+ * @return NONE
+ */
+void bindSketch(GLint engine);
+
+/**
+ * generateMesh
+ * @param GLuint generation - the job's generation in mesh_jobs
+ * background job: runs the graph of the current engine on thread_pool,
+ * skipping the outline stages once they completed for this sketch; stages
+ * not yet started when a newer job or a reset cancels it are skipped
+ * @return GLboolean - GL_FALSE if it was cancelled
+ */
+GLboolean generateMesh(GLuint generation);
+
+/**
+ * shiftStroke
+ * @param NONE
+ * moves the stroke by the offset window resizes left owing, kept back
+ * while a mesh job may be reading it
+ * @return NONE
+ */
+void shiftStroke(void);
+
+/**
+ * publishMesh, finishMesh & pollMesh
+ * @param int value - unused GLUT timer value
+ * publishMesh takes over the mesh of the finished job, sets its rest
+ * positions and fairs it; finishMesh first waits for the job, and
+ * pollMesh is the timer that publishes it once the thread is idle. Both
+ * first clear a stale sketch and submit the job inflateSketch held back.
+ * Anything that reads or edits the sketch calls finishMesh first.
+ * @return NONE
+ */
+void publishMesh(void);
+void finishMesh(void);
+void pollMesh(int value);
+
+/**
+ * togglePreview, previewTick & drawPreview
+ * @param int value - unused GLUT timer value
+ * togglePreview switches live previews on or off. previewTick is the timer
+ * that runs PREVIEW_RATE times a second while a preview is wanted: it
+ * publishes a finished preview, and if the stroke grew since the last one
+ * and no preview job runs, starts the next. The job drains input_events
+ * into its own copy of the stroke and closes it with generateClosingPoints,
+ * so the mouse callbacks only ever push events. drawPreview draws the
+ * published preview, turned to show its depth, in a side viewport of the
+ * Drawing State.
+ * @return NONE
+ */
+void togglePreview(void);
+void previewTick(int value);
+void drawPreview(void);
+
+/**
+ * cycleInflationEngine
+ * @param NONE
+ * selects the next inflation engine and rebuilds the mesh in 3D view
+ * @return NONE
+ */
+void cycleInflationEngine(void);
+
+/**
+ * fairMesh
+ * @param NONE
+ * replaces mesh_verts with mesh_rest faired by the current mode and weight,
+ * and restarts the optimizer from the result; only a topology change
+ * redoes the symbolic factorization
+ * @return NONE
+ */
+void fairMesh(void);
+
+/**
+ * cycleFairing
+ * @param NONE
+ * switches fairing off, to uniform or to cotangent weights
+ * @return NONE
+ */
+void cycleFairing(void);
+
+/**
+ * scaleFairingWeight
+ * @param GLfloat factor - multiplies the fairing weight
+ * refairs the current mesh with the new weight
+ * @return NONE
+ */
+void scaleFairingWeight(GLfloat factor);
+
+/**
+ * toggleOptimizer
+ * @param NONE
+ * starts or stops the curvature optimizer; stopping shows the mesh it
+ * started from again
+ * @return NONE
+ */
+void toggleOptimizer(void);
+
+/**
+ * optimizeIdle
+ * @param NONE
+ * GLUT idle callback: runs the optimizer for optimize_budget milliseconds,
+ * shows the result and unregisters itself once converged
+ * @return NONE
+ */
+void optimizeIdle(void);
+
+/**
+ * remeshMesh
  * @param NONE
- * loops through connected to generate the verticies that make up the shape
+ * isotropically remeshes the viewed mesh toward its mean edge length; an
+ * inflated mesh is remeshed before fairing, a loaded one in place
  * @return NONE
  */
- void calculateVerticesDriver();
+void remeshMesh(void);
 
- /**
- * calculateMidpoint
- * @param GLint index - the index of the two points in connected
- * calculates the midpoint of two verices in connected
- * @return Vector3f - the midpoint of the two points at the given index
+/**
+ * cycleSubdivision
+ * @param NONE
+ * draws the viewed mesh with the next number of Loop subdivision levels
+ * @return NONE
  */
- Vector3f calculateMidpoint(GLint index);
+void cycleSubdivision(void);
 
- /**
- * calculateVertices
- * @param GLint index - the index of the two vertices in connected
- * @param GLfloat theta - the degree to rotate the point around the midpoint by
- * Takes the point on the curve and rotates it around the midline in the shape to give a 3d representation of the shape
- * appends this vertex to the vector mesh_verts
+/**
+ * printStats
+ * @param NONE
+ * prints the heap allocations since the last call, the sketch arena
+ * counters and the mesh builder's buffer growths, which stay flat once
+ * sketches stop growing, the input event counters and
+ * latency, and the stage timings of the last mesh built with the current
+ * engine
  * @return NONE
  */
-void calculateVertices(GLint index, GLfloat Theta);
+void printStats(void);
+
+/**
+ * rebuildRings
+ * @param NONE
+ * re-tessellates the current sketch after a ring setting changed, through
+ * the mesh job in either view, so the faces, weld and rest positions are
+ * rebuilt with the vertices
+ * @return NONE
+ */
+void rebuildRings(void);
 
 /**
  * generateClosingPoints
- * Uses the first and last vertices of a user stroke to create
+ * Uses the first and last vertices of a stroke to append
  * connecting vertices, via the Midpoint formula, to create a closed
  * planar polygon.
  */
@@ -197,58 +516,91 @@ GLfloat calcAngle(GLfloat BA, GLfloat BC, GLfloat AC);
 
 /**
  * findNextPoint
+ * @param vector<Vector3f> &points - the stroke
  * @param GLint i - Index of stroke vertex
  * @param GLint distance - distance to next stroke vertex
  * Uses a stroke vertex and the distance for the next point location
  * to find the next significant vertex in the stroke.
  * @return GLint - Index of next significant stroke vertex
  */
-GLint findNextPoint(GLint i, GLint distance);
+GLint findNextPoint(const vector<Vector3f> &points, GLint i, GLint distance);
 
 /**
  * getOutsideEdges
- * @param NONE
- * Populates the vector points_on_curve with points from the vector stroke.
+ * @param vector<Vector3f> &points - the stroke
+ * @param vector<Vector3f> &outline - receives the significant stroke vertices
+ * Populates the vector outline with points from the stroke.
  * @return NONE
 */
-void getOutsideEdges(void);
+void getOutsideEdges(const vector<Vector3f> &points, vector<Vector3f> &outline);
+
+/**
+ * triangulateOutline
+ * @param vector<Vector3f> &outline - significant stroke vertices
+ * @param Triangulation &tri - receives the triangulation
+ * Computes the constrained Delaunay triangulation of outline.
+ * @return NONE
+*/
+void triangulateOutline(const vector<Vector3f> &outline, Triangulation &tri);
+
+/**
+ * extractSpine
+ * @param Triangulation &tri - the outline triangulation
+ * @param Spine &axis - receives the spine
+ * Builds the pruned chordal axis of the outline triangulation.
+ * @return NONE
+*/
+void extractSpine(const Triangulation &tri, Spine &axis);
 
 /**
  * populateConnected
- * @param NONE
- * Populates the vector connected with a pairs of points that are across the shape from each other
+ * @param vector<Vector3f> &outline - significant stroke vertices
+ * @param vector<Pair> &pairs - receives the chords
+ * @param Vector3f &last - receives the last outline point in the shape
+ * Populates the vector pairs with a pairs of points that are across the shape from each other
  * @return NONE
 */
-void populateConnected();
+void populateConnected(const vector<Vector3f> &outline, vector<Pair> &pairs,
+                       Vector3f &last);
 
 /**
  * iterateThrough
- * @param GLint count_forward - index in points_on_curve to count from
- * @param GLint count_back - index in points_on_curve to count backward from
- * Iterates over points_on_curve from count forward to count backward
+ * @param vector<Vector3f> &outline - significant stroke vertices
+ * @param GLint count_forward - index in outline to count from
+ * @param GLint count_back - index in outline to count backward from
+ * @param vector<Pair> &pairs - receives the chords
+ * @param Vector3f &last - receives the last outline point in the shape
+ * Iterates over outline from count forward to count backward
  * @return NONE
 */
-void iterateThrough(GLint count_forward, GLint count_back);
+void iterateThrough(const vector<Vector3f> &outline, GLint count_forward, GLint count_back,
+                    vector<Pair> &pairs, Vector3f &last);
 
 /**
  * checkPoints_CountForward
+ * @param vector<Vector3f> &outline - significant stroke vertices
  * @param GLint index1 - the index from the front
  * @param GLint index2 - the index from the back
+ * @param vector<Pair> &pairs - receives the chord
  * Finds if a point is within expected area, and if not, recurses until proper point is found
  * Checks from the forward position
  * @return NONE
 */
-GLint checkPoints_CountForward(GLint index1, GLint index2);
+GLint checkPoints_CountForward(const vector<Vector3f> &outline, GLint index1, GLint index2,
+                               vector<Pair> &pairs);
 
 /**
  * checkPoints_CountBack
+ * @param vector<Vector3f> &outline - significant stroke vertices
  * @param GLint index1 - the index from the back
  * @param GLint index2 - the index from the front
+ * @param vector<Pair> &pairs - receives the chord
  * Finds if a point is within expected area, and if not, recurses until proper point is found
  * Checks from the back position
  * @return GLint - 0 if not recursed, otherwise the number of indexes skipped
 */
-GLint checkPoints_CountBack(GLint index1, GLint index2);
+GLint checkPoints_CountBack(const vector<Vector3f> &outline, GLint index1, GLint index2,
+                            vector<Pair> &pairs);
 
 /**
  * getNormal
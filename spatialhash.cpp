@@ -0,0 +1,203 @@
+#include "spatialhash.h"
+
+#include <algorithm>
+#include <cmath>
+
+// Table doubles once more than this fraction of its slots hold cells
+static const GLuint HASH_LOAD_NUM = 2, HASH_LOAD_DEN = 3;
+
+// Bits per packed cell coordinate
+static const GLuint HASH_BITS = 21;
+
+static unsigned long long mix(unsigned long long k)
+{
+    k *= 0x9E3779B97F4A7C15ULL;
+    return k ^ (k >> 29);
+}
+
+// High hash bits kept in a slot to skip most foreign cells unread
+static GLuint tag(unsigned long long h)
+{
+    return (GLuint)(h >> 32);
+}
+
+SpatialHash::SpatialHash(const vector<Vector3f> &points, GLfloat cell_size,
+    GLuint expected, Arena *arena)
+    : points(points), inv_cell(1.0f / cell_size), table(ScratchAllocator<Slot>(arena)),
+      next(ScratchAllocator<GLint>(arena)), cells(0), entries(0)
+{
+    GLuint size = 16;
+    while ((unsigned long long)size * HASH_LOAD_NUM < (unsigned long long)expected * HASH_LOAD_DEN)
+        size <<= 1;
+    table.assign(size, Slot());
+    next.assign(points.size(), -1);
+}
+
+unsigned long long SpatialHash::key(long long x, long long y, long long z) const
+{
+    const unsigned long long mask = (1ULL << HASH_BITS) - 1;
+    return (((unsigned long long)x & mask) << (2 * HASH_BITS)) |
+           (((unsigned long long)y & mask) << HASH_BITS) |
+           ((unsigned long long)z & mask);
+}
+
+unsigned long long SpatialHash::key(const Vector3f &p) const
+{
+    return key((long long)floorf(p.x() * inv_cell), (long long)floorf(p.y() * inv_cell),
+               (long long)floorf(p.z() * inv_cell));
+}
+
+/**
+ * find
+ * Linear probing for the slot of cell k, or the empty slot it would take.
+ */
+GLuint SpatialHash::find(unsigned long long k) const
+{
+    unsigned long long h = mix(k);
+    GLuint mask = table.size() - 1, i = h & mask, t = tag(h);
+
+    while (table[i].head >= 0 &&
+           (table[i].tag != t || key(points[table[i].head]) != k))
+        i = (i + 1) & mask;
+    return i;
+}
+
+void SpatialHash::grow(void)
+{
+    ScratchVector<Slot> old(2 * table.size(), Slot(), table.get_allocator());
+
+    old.swap(table);
+    for (GLuint s = 0; s < old.size(); s++) {
+        if (old[s].head < 0) continue;
+        table[find(key(points[old[s].head]))] = old[s];
+    }
+}
+
+void SpatialHash::insert(GLuint i)
+{
+    if (i >= next.size()) next.resize(i + 1, -1);
+    if ((unsigned long long)(cells + 1) * HASH_LOAD_DEN > (unsigned long long)table.size() * HASH_LOAD_NUM)
+        grow();
+
+    unsigned long long k = key(points[i]);
+    GLuint s = find(k);
+    if (table[s].head < 0) cells++;
+    next[i] = table[s].head;
+    table[s].head = i;
+    table[s].tag = tag(mix(k));
+    entries++;
+}
+
+GLint SpatialHash::nearest(const Vector3f &p, GLfloat r) const
+{
+    GLint best = -1;
+    GLfloat best_d = r * r;
+
+    for (long long x = floorf((p.x() - r) * inv_cell); x <= floorf((p.x() + r) * inv_cell); x++)
+    for (long long y = floorf((p.y() - r) * inv_cell); y <= floorf((p.y() + r) * inv_cell); y++)
+    for (long long z = floorf((p.z() - r) * inv_cell); z <= floorf((p.z() + r) * inv_cell); z++) {
+        for (GLint j = table[find(key(x, y, z))].head; j >= 0; j = next[j]) {
+            GLfloat d = (points[j] - p).squaredNorm();
+            if (d < best_d || (d == best_d && (best < 0 || j < best))) {
+                best = j;
+                best_d = d;
+            }
+        }
+    }
+    return best;
+}
+
+void SpatialHash::radius(const Vector3f &p, GLfloat r, vector<GLuint> &out) const
+{
+    out.clear();
+    for (long long x = floorf((p.x() - r) * inv_cell); x <= floorf((p.x() + r) * inv_cell); x++)
+    for (long long y = floorf((p.y() - r) * inv_cell); y <= floorf((p.y() + r) * inv_cell); y++)
+    for (long long z = floorf((p.z() - r) * inv_cell); z <= floorf((p.z() + r) * inv_cell); z++) {
+        for (GLint j = table[find(key(x, y, z))].head; j >= 0; j = next[j])
+            if ((points[j] - p).squaredNorm() <= r * r) out.push_back(j);
+    }
+}
+
+GLfloat weldDistance(const vector<Vector3f> &verts)
+{
+    if (verts.empty()) return 0.0f;
+
+    Vector3f lo = verts[0], hi = verts[0];
+    for (GLuint i = 1; i < verts.size(); i++) {
+        lo = lo.cwiseMin(verts[i]);
+        hi = hi.cwiseMax(verts[i]);
+    }
+    return WELD_TOLERANCE * (hi - lo).maxCoeff();
+}
+
+/**
+ * weld
+ * weldVertices without the checks, allocating from arena.
+ */
+static GLuint weld(vector<Vector3f> &verts, vector<Triangle> &faces, GLfloat epsilon,
+    Arena *arena, vector<GLuint> *marked)
+{
+    GLuint n = verts.size(), kept = 0;
+
+    // Every vertex maps to the kept vertex it merges into, or itself;
+    // in cells 8 epsilon wide most query balls touch one or two cells.
+    // There are at most n cells, so the table never grows. With remap the
+    // weld takes five to eight indices per vertex from the arena.
+    ScratchVector<GLint> remap(n, 0, ScratchAllocator<GLint>(arena));
+    {
+        SpatialHash grid(verts, 8.0f * epsilon, n, arena);
+        for (GLuint i = 0; i < n; i++) {
+            remap[i] = i;
+            if (!verts[i].allFinite()) continue;
+            GLint j = grid.nearest(verts[i], epsilon);
+            if (j >= 0) remap[i] = j;
+            else        grid.insert(i);
+        }
+    }
+
+    // Compact in place; kept vertices come before anything merged into them
+    for (GLuint i = 0; i < n; i++) {
+        if (remap[i] == (GLint)i) {
+            verts[kept] = verts[i];
+            remap[i] = kept++;
+        } else {
+            remap[i] = remap[remap[i]];
+        }
+    }
+    verts.resize(kept);
+
+    GLuint count = 0;
+    for (GLuint f = 0; f < faces.size(); f++) {
+        const Triangle &t = faces[f];
+        if (t.vertex1 >= n || t.vertex2 >= n || t.vertex3 >= n) continue;
+        GLuint a = remap[t.vertex1], b = remap[t.vertex2], c = remap[t.vertex3];
+        if (a == b || b == c || c == a) continue;
+        faces[count++] = Triangle(a, b, c);
+    }
+    faces.resize(count);
+
+    if (marked) {
+        vector<GLuint> &m = *marked;
+        count = 0;
+        for (GLuint k = 0; k < m.size(); k++)
+            if (m[k] < n) m[count++] = remap[m[k]];
+        m.resize(count);
+        std::sort(m.begin(), m.end());
+        m.erase(std::unique(m.begin(), m.end()), m.end());
+    }
+    return n - kept;
+}
+
+GLuint weldVertices(vector<Vector3f> &verts, vector<Triangle> &faces, GLfloat epsilon,
+    Arena *arena, vector<GLuint> *marked)
+{
+    GLuint n = verts.size();
+
+    if (n == 0 || !(epsilon > 0.0f)) return 0;
+
+    Arena::Mark mark = {0, 0, 0};
+    if (arena) mark = arena->mark();
+    GLuint removed = weld(verts, faces, epsilon, arena, marked);
+    if (arena) arena->rewind(mark);
+    return removed;
+}
@@ -0,0 +1,108 @@
+/**
+ * spatialhash.h
+ * This file contains the SpatialHash class, a uniform grid over points of
+ * an external array, and weldVertices, which merges vertices closer than
+ * a tolerance. Cells are keyed by their packed integer coordinates in an
+ * open-addressing table that holds only the newest point of every cell
+ * and a tag of its hash; the points of a cell are chained through a next
+ * index per point. Keys are recomputed from the stored points instead of
+ * being kept, so a slot is two indices. Kept under two thirds full in a
+ * power-of-two table, the slots and chains cost four to seven indices per
+ * point, and welding runs in linear expected time and memory.
+ */
+
+#ifndef _SPATIALHASH_H_
+#define _SPATIALHASH_H_
+
+#ifdef __APPLE__
+#include <OpenGL/gl.h>
+#else
+#include <GL/gl.h>
+#endif
+
+#include <vector>
+#include <Eigen/Core>
+#include "mesh.h"
+#include "scratch.h"
+
+using std::vector;
+using Eigen::Vector3f;
+
+// Weld distance as a fraction of the largest bounding box extent
+const GLfloat WELD_TOLERANCE = 1e-5f;
+
+class SpatialHash
+{
+public:
+    /**
+     * SpatialHash
+     * An empty grid of the given cell size over points, with room for
+     * expected cells before it grows, allocated from arena if one is
+     * given. points must outlive the grid and keep the inserted entries
+     * in place.
+     */
+    SpatialHash(const vector<Vector3f> &points, GLfloat cell_size, GLuint expected = 0,
+        Arena *arena = NULL);
+
+    /**
+     * insert
+     * Adds points[i] to its cell.
+     */
+    void insert(GLuint i);
+
+    /**
+     * nearest
+     * @return GLint - the inserted point nearest to p within r, the lowest
+     *                 index among equals, or -1
+     */
+    GLint nearest(const Vector3f &p, GLfloat r) const;
+
+    /**
+     * radius
+     * Fills out with the inserted points within r of p, by cell.
+     */
+    void radius(const Vector3f &p, GLfloat r, vector<GLuint> &out) const;
+
+    GLuint size(void) const
+        { return entries; }
+
+private:
+    struct Slot {
+        GLint head;             // newest point of the cell, -1 if empty
+        GLuint tag;             // high bits of the cell's hash
+
+        Slot(void) : head(-1), tag(0) {}
+    };
+
+    const vector<Vector3f> &points;
+    GLfloat inv_cell;
+    ScratchVector<Slot> table;
+    ScratchVector<GLint> next;  // older point of the same cell, -1 if none
+    GLuint cells, entries;
+
+    unsigned long long key(const Vector3f &p) const;
+    unsigned long long key(long long x, long long y, long long z) const;
+    GLuint find(unsigned long long k) const;
+    void grow(void);
+};
+
+/**
+ * weldDistance
+ * @return GLfloat - WELD_TOLERANCE times the largest extent of verts
+ */
+GLfloat weldDistance(const vector<Vector3f> &verts);
+
+/**
+ * weldVertices
+ * Merges every vertex into the nearest earlier kept vertex within
+ * epsilon, remaps faces and drops the faces that collapse or index past
+ * the vertices. Kept vertices stay in order. Scratch space comes from
+ * arena if one is given, and is rewound before returning. Sorted vertex
+ * indices in marked, such as a silhouette, are renumbered along; a kept
+ * vertex is marked if anything merged into it was.
+ * @return GLuint - vertices removed
+ */
+GLuint weldVertices(vector<Vector3f> &verts, vector<Triangle> &faces, GLfloat epsilon,
+    Arena *arena = NULL, vector<GLuint> *marked = NULL);
+
+#endif
@@ -0,0 +1,303 @@
+#include "spine.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+void Spine::clear(void)
+{
+    types.clear();
+    nodes.clear();
+    radius.clear();
+    chords.clear();
+    kinds.clear();
+    fan_offsets.clear();
+    fan.clear();
+    edges.clear();
+    adj_offsets.clear();
+    adj.clear();
+    chain_offsets.clear();
+    chains.clear();
+}
+
+GLboolean Spine::build(const Triangulation &tri)
+{
+    GLint nt = tri.size(), t, i, u, j;
+
+    clear();
+    attach.clear();
+    if (nt == 0) return GL_FALSE;
+
+    // Classify triangles by their number of outline edges
+    types.resize(nt);
+    for (t = 0; t < nt; t++) {
+        GLint outer = 0;
+        for (i = 0; i < 3; i++)
+            outer += tri.isOutline(t, i);
+        types[t] = (outer == 0) ? JUNCTION : (outer == 1) ? SLEEVE :
+                   (outer == 2) ? TERMINAL : ISOLATED;
+    }
+
+    // One node at the midpoint of every internal edge
+    edge_node.assign(3 * nt, -1);
+    tri_node.assign(nt, -1);
+    owner.assign(nt, -1);
+    for (t = 0; t < nt; t++) {
+        for (i = 0; i < 3; i++) {
+            u = tri.neighbors[3*t + i];
+            if (u < t) continue;
+
+            GLint a = tri.vertex(t, i), b = tri.vertex(t, (i + 1) % 3);
+            Vector2f d = tri.points[b] - tri.points[a];
+            GLint id = nodes.size();
+
+            nodes.push_back((tri.points[a] + tri.points[b]) / 2);
+            chords.push_back(d.normalized());
+            kinds.push_back(SPINE_SLEEVE);
+            attach.push_back(id); attach.push_back(a);
+            attach.push_back(id); attach.push_back(b);
+
+            edge_node[3*t + i] = id;
+            for (j = 0; tri.neighbors[3*u + j] != t; j++);
+            edge_node[3*u + j] = id;
+        }
+    }
+
+    // One node at the centroid of every junction triangle
+    for (t = 0; t < nt; t++) {
+        if (types[t] != JUNCTION && types[t] != ISOLATED) continue;
+
+        GLint id = nodes.size();
+        Vector2f c(0.0f, 0.0f);
+        for (i = 0; i < 3; i++) {
+            c += tri.points[tri.vertex(t, i)];
+            attach.push_back(id);
+            attach.push_back(tri.vertex(t, i));
+        }
+        nodes.push_back(c / 3);
+        chords.push_back(Vector2f(0.0f, 0.0f));
+        kinds.push_back(types[t] == JUNCTION ? SPINE_JUNCTION : SPINE_END);
+        tri_node[t] = id;
+    }
+
+    // Prune every branch from its terminal triangle inward
+    remap.assign(nodes.size(), 1);
+    for (t = 0; t < nt; t++)
+        if (types[t] == TERMINAL)
+            prune(tri, t);
+
+    // Connect the surviving nodes through the unpruned triangles
+    for (t = 0; t < nt; t++) {
+        if (owner[t] >= 0) continue;
+
+        if (types[t] == SLEEVE) {
+            GLint n0 = -1, n1 = -1;
+            for (i = 0; i < 3; i++) {
+                if (edge_node[3*t + i] < 0) continue;
+                if (n0 < 0) n0 = edge_node[3*t + i];
+                else n1 = edge_node[3*t + i];
+            }
+            edges.push_back(n0);
+            edges.push_back(n1);
+        } else if (types[t] == JUNCTION) {
+            for (i = 0; i < 3; i++) {
+                GLint n = edge_node[3*t + i];
+                if (remap[n]) {
+                    edges.push_back(tri_node[t]);
+                    edges.push_back(n);
+                }
+            }
+        }
+    }
+
+    compact(tri);
+    buildChains();
+    return GL_TRUE;
+}
+
+/**
+ * prune
+ * Walks a branch from terminal triangle t, merging triangles while every
+ * vertex of the merged region lies within the circle whose diameter is the
+ * next chord. The region is then fanned to the chord it stopped at, or to
+ * the junction it reached. Each triangle joins at most one walk.
+ * Region vertices are not all rechecked at every chord: each keeps its
+ * distance to the midpoint it was last checked against, which plus the
+ * distance the midpoint moved since bounds its distance to the current
+ * one. Only vertices whose bound exceeds the circle are checked again,
+ * which on smooth ends are the few near the chord.
+ */
+void Spine::prune(const Triangulation &tri, GLint t)
+{
+    GLint cur = t, e, i, j, u, end = -1;
+
+    region.clear();
+    walk.clear();
+    reach.clear();
+    walk.push_back(t);
+    for (i = 0; i < 3; i++) {
+        region.push_back(tri.vertex(t, i));
+        reach.push_back(std::make_pair(FLT_MAX, region.back()));
+    }
+    for (e = 0; tri.isOutline(t, e); e++);
+
+    // Heap keys are distances at the last check less the drift by then
+    Vector2f last = (tri.points[tri.vertex(t, e)] + tri.points[tri.vertex(t, (e + 1) % 3)]) / 2;
+    GLfloat drift = 0.0f;
+
+    for (;;) {
+        GLint node = edge_node[3*cur + e];
+        GLint a = tri.vertex(cur, e), b = tri.vertex(cur, (e + 1) % 3);
+        Vector2f mid = (tri.points[a] + tri.points[b]) / 2;
+        GLfloat r2 = (tri.points[b] - tri.points[a]).squaredNorm() / 4;
+
+        // Semicircle test on the chord we are about to remove, with a
+        // margin on the bounds for the rounding the drift gathers
+        GLboolean inside = GL_TRUE;
+        GLfloat limit = sqrtf(r2 * 1.0001f) * 0.99999f;
+        drift += (mid - last).norm();
+        last = mid;
+        GLuint heap = reach.size();
+        while (inside && heap && reach[0].first + drift > limit) {
+            std::pop_heap(reach.begin(), reach.begin() + heap--);
+            GLfloat d2 = (tri.points[reach[heap].second] - mid).squaredNorm();
+            inside = d2 <= r2 * 1.0001f;
+            reach[heap].first = sqrtf(d2) - drift;
+        }
+        while (heap < reach.size())
+            std::push_heap(reach.begin(), reach.begin() + ++heap);
+
+        u = tri.neighbors[3*cur + e];
+        if (!inside || owner[u] >= 0 || types[u] == TERMINAL) {
+            kinds[node] = SPINE_END;
+            end = node;
+            break;
+        }
+
+        // Chord is insignificant, so drop it and merge the next triangle
+        remap[node] = 0;
+        for (j = 0; tri.neighbors[3*u + j] != cur; j++);
+        if (types[u] == JUNCTION) {
+            end = tri_node[u];
+            break;
+        }
+
+        walk.push_back(u);
+        region.push_back(tri.vertex(u, (j + 2) % 3));
+        reach.push_back(std::make_pair(FLT_MAX, region.back()));
+        std::push_heap(reach.begin(), reach.end());
+        for (i = 0; i == j || tri.isOutline(u, i); i++);
+        cur = u;
+        e = i;
+    }
+
+    for (i = 0; i < (GLint)walk.size(); i++)
+        owner[walk[i]] = end;
+    for (i = 0; i < (GLint)region.size(); i++) {
+        attach.push_back(end);
+        attach.push_back(region[i]);
+    }
+}
+
+void Spine::compact(const Triangulation &tri)
+{
+    GLint n = nodes.size(), count = 0, i;
+
+    for (i = 0; i < n; i++) {
+        if (!remap[i]) {
+            remap[i] = -1;
+            continue;
+        }
+        remap[i] = count;
+        nodes[count]  = nodes[i];
+        chords[count] = chords[i];
+        kinds[count]  = kinds[i];
+        count++;
+    }
+    nodes.resize(count);
+    chords.resize(count);
+    kinds.resize(count);
+
+    for (i = 0; i < (GLint)edges.size(); i++)
+        edges[i] = remap[edges[i]];
+
+    // Outline vertices per node, dropping links to pruned chords
+    counts.assign(count + 1, 0);
+    for (i = 0; i < (GLint)attach.size(); i += 2)
+        if (remap[attach[i]] >= 0)
+            counts[remap[attach[i]] + 1]++;
+    for (i = 0; i < count; i++)
+        counts[i + 1] += counts[i];
+    fan_offsets = counts;
+    fan.resize(counts[count]);
+    for (i = 0; i < (GLint)attach.size(); i += 2) {
+        GLint node = remap[attach[i]];
+        if (node >= 0)
+            fan[counts[node]++] = attach[i + 1];
+    }
+
+    // Elevation radius is the mean distance to the connected outline
+    radius.assign(count, 0.0f);
+    for (i = 0; i < count; i++) {
+        GLint k, m = fan_offsets[i + 1] - fan_offsets[i];
+        for (k = fan_offsets[i]; k < fan_offsets[i + 1]; k++)
+            radius[i] += (tri.points[fan[k]] - nodes[i]).norm();
+        if (m) radius[i] /= m;
+    }
+
+    // Node adjacency
+    counts.assign(count + 1, 0);
+    for (i = 0; i < (GLint)edges.size(); i++)
+        counts[edges[i] + 1]++;
+    for (i = 0; i < count; i++)
+        counts[i + 1] += counts[i];
+    adj_offsets = counts;
+    adj.resize(edges.size());
+    for (i = 0; i < (GLint)edges.size(); i += 2) {
+        adj[counts[edges[i]]++]     = edges[i + 1];
+        adj[counts[edges[i + 1]]++] = edges[i];
+    }
+}
+
+void Spine::buildChains(void)
+{
+    GLint n = nodes.size(), i, k;
+
+    visited.assign(adj.size(), 0);
+    chain_offsets.clear();
+    chain_offsets.push_back(0);
+
+    // Paths start at ends and junctions; a pass over degree-2 nodes
+    // afterwards picks up any closed loop.
+    for (GLint pass = 0; pass < 2; pass++) {
+        for (i = 0; i < n; i++) {
+            if ((pass == 0) == (degree(i) == 2)) continue;
+
+            if (degree(i) == 0) {
+                chains.push_back(i);
+                chain_offsets.push_back(chains.size());
+                continue;
+            }
+
+            for (k = adj_offsets[i]; k < adj_offsets[i + 1]; k++) {
+                if (visited[k]) continue;
+
+                GLint prev = i, slot = k;
+                chains.push_back(i);
+                for (;;) {
+                    GLint next = adj[slot], s;
+                    visited[slot] = 1;
+                    for (s = adj_offsets[next]; adj[s] != prev || visited[s]; s++);
+                    visited[s] = 1;
+                    chains.push_back(next);
+
+                    if (degree(next) != 2 || next == i) break;
+                    for (s = adj_offsets[next]; visited[s]; s++);
+                    prev = next;
+                    slot = s;
+                }
+                chain_offsets.push_back(chains.size());
+            }
+        }
+    }
+}
@@ -0,0 +1,97 @@
+/**
+ * spine.h
+ * This file contains the Spine class, which extracts the chordal axis of a
+ * constrained Delaunay triangulation and prunes its insignificant branches
+ * with the semicircle test from the Teddy paper. The result is a graph of
+ * spine nodes that inflation, cutting and extrusion can share.
+ */
+
+#ifndef _SPINE_H_
+#define _SPINE_H_
+
+#ifdef __APPLE__
+#include <OpenGL/gl.h>
+#else
+#include <GL/gl.h>
+#endif
+
+#include <utility>
+#include <vector>
+#include <Eigen/Core>
+#include "triangulation.h"
+
+using std::vector;
+using Eigen::Vector2f;
+
+enum TriangleType { TERMINAL, SLEEVE, JUNCTION, ISOLATED };
+enum SpineNodeType { SPINE_SLEEVE, SPINE_JUNCTION, SPINE_END };
+
+class Spine
+{
+public:
+    // Per triangle classification, indexed like Triangulation::triangles
+    vector<unsigned char> types;
+
+    // Spine Nodes
+    vector<Vector2f>      nodes;      // node positions
+    vector<GLfloat>       radius;     // mean distance to connected outline
+    vector<Vector2f>      chords;     // unit chord direction, zero at junctions
+    vector<unsigned char> kinds;      // SpineNodeType per node
+
+    // Outline vertices attached to each node, in CSR form
+    vector<GLint>         fan_offsets;
+    vector<GLint>         fan;
+
+    // Spine Edges, 2 node indices per edge, plus CSR node adjacency
+    vector<GLint>         edges;
+    vector<GLint>         adj_offsets;
+    vector<GLint>         adj;
+
+    // Maximal node paths whose interior nodes have degree 2
+    vector<GLint>         chain_offsets;
+    vector<GLint>         chains;
+
+    Spine(void) {}
+
+    /**
+     * build
+     * @param Triangulation tri - interior triangulation of the outline
+     * Classifies triangles, builds the chordal axis and prunes terminal
+     * branches whose vertices fall within the semicircle on their chord.
+     * @return GLboolean - GL_FALSE if the triangulation is empty
+     */
+    GLboolean build(const Triangulation &tri);
+
+    /**
+     * clear
+     * Empties the spine while keeping allocated storage.
+     */
+    void clear(void);
+
+    GLuint size(void) const
+        { return nodes.size(); }
+
+    GLuint numChains(void) const
+        { return chain_offsets.size() ? chain_offsets.size() - 1 : 0; }
+
+    GLint degree(GLuint n) const
+        { return adj_offsets[n + 1] - adj_offsets[n]; }
+
+private:
+    vector<GLint>         edge_node;  // 3 per triangle, chord node or -1
+    vector<GLint>         tri_node;   // junction node per triangle or -1
+    vector<GLint>         owner;      // node a pruned triangle fans to
+    vector<GLint>         region;     // outline vertices of a pruned walk
+    vector<GLint>         walk;       // triangles merged by a pruned walk
+    vector<std::pair<GLfloat, GLint> > reach;  // region heap, see prune
+    vector<GLint>         attach;     // (node, outline vertex) pairs
+    vector<GLint>         remap;      // node compaction
+    vector<GLint>         counts;     // CSR scratch
+    vector<unsigned char> visited;    // chain walk flags
+
+    void prune(const Triangulation &tri, GLint t);
+    void compact(const Triangulation &tri);
+    void buildChains(void);
+};
+
+#endif
@@ -0,0 +1,185 @@
+#include "subdivision.h"
+
+#include <algorithm>
+#include <cmath>
+
+// Refined vertices per parallel slice
+static const GLuint SUBDIVISION_GRAIN = 4096;
+
+/**
+ * EdgeCorner struct
+ * Face corner h seen from the edge leaving it, keyed by its endpoints.
+ */
+struct EdgeCorner {
+    unsigned long long key;
+    GLuint corner;
+
+    bool operator<(const EdgeCorner &e) const
+        { return key < e.key || (key == e.key && corner < e.corner); }
+};
+
+/**
+ * loopBeta
+ * Neighbor weight of an interior vertex of valence n.
+ */
+static GLfloat loopBeta(GLuint n)
+{
+    GLdouble c = 0.375 + 0.25 * cos(2.0 * M_PI / n);
+    return (GLfloat)((0.625 - c * c) / n);
+}
+
+/**
+ * refine
+ * One level of Loop subdivision: every edge gets a vertex numbered after
+ * the n old ones, every face becomes four, and step maps old positions to
+ * new ones. Boundary edges use the cubic B-spline rule; vertices on
+ * non-manifold edges or with more than two boundary edges stay put.
+ */
+void Subdivider::refine(GLuint n, const vector<Triangle> &in, vector<Triangle> &out,
+    Stencil &step)
+{
+    GLuint nf = in.size(), h, e;
+    vector<EdgeCorner> corners(3 * nf);
+
+    for (h = 0; h < 3 * nf; h++) {
+        const Triangle &t = in[h / 3];
+        const GLuint v[3] = { t.vertex1, t.vertex2, t.vertex3 };
+        unsigned long long a = v[h % 3], b = v[(h + 1) % 3];
+        corners[h].key = (std::min(a, b) << 32) | std::max(a, b);
+        corners[h].corner = h;
+    }
+    std::sort(corners.begin(), corners.end());
+
+    // Edges in key order, with their faces' opposite vertices
+    vector<GLuint> edge_of(3 * nf), ends, opposite, faces_on;
+    for (h = 0; h < corners.size(); h++) {
+        const EdgeCorner &c = corners[h];
+        const Triangle &t = in[c.corner / 3];
+        const GLuint v[3] = { t.vertex1, t.vertex2, t.vertex3 };
+
+        if (h == 0 || c.key != corners[h - 1].key) {
+            ends.push_back(c.key >> 32);
+            ends.push_back(c.key & 0xffffffffULL);
+            opposite.push_back(0);
+            opposite.push_back(0);
+            faces_on.push_back(0);
+        }
+        e = faces_on.size() - 1;
+        if (faces_on[e] < 2) opposite[2 * e + faces_on[e]] = v[(c.corner + 2) % 3];
+        faces_on[e]++;
+        edge_of[c.corner] = e;
+    }
+    GLuint ne = faces_on.size();
+
+    vector<GLuint> valence(n, 0), boundary(n, 0);
+    vector<unsigned char> pinned(n, 0);
+    for (e = 0; e < ne; e++) {
+        GLuint a = ends[2 * e], b = ends[2 * e + 1];
+        valence[a]++;
+        valence[b]++;
+        if (faces_on[e] == 1) { boundary[a]++; boundary[b]++; }
+        if (faces_on[e] > 2)  pinned[a] = pinned[b] = 1;
+    }
+
+    vector<Eigen::Triplet<GLfloat> > entries;
+    entries.reserve(n + 7 * ne);
+
+    // Old vertices
+    for (GLuint v = 0; v < n; v++) {
+        GLfloat self = 1.0f;
+        if (!pinned[v] && boundary[v] == 2)
+            self = 0.75f;
+        else if (!pinned[v] && boundary[v] == 0 && valence[v] >= 3)
+            self = 1.0f - valence[v] * loopBeta(valence[v]);
+        entries.push_back(Eigen::Triplet<GLfloat>(v, v, self));
+    }
+    for (e = 0; e < ne; e++) {
+        for (GLuint side = 0; side < 2; side++) {
+            GLuint v = ends[2 * e + side], u = ends[2 * e + 1 - side];
+            if (pinned[v]) continue;
+            if (boundary[v] == 2 && faces_on[e] == 1)
+                entries.push_back(Eigen::Triplet<GLfloat>(v, u, 0.125f));
+            else if (boundary[v] == 0 && valence[v] >= 3)
+                entries.push_back(Eigen::Triplet<GLfloat>(v, u, loopBeta(valence[v])));
+        }
+    }
+
+    // Edge vertices
+    for (e = 0; e < ne; e++) {
+        GLuint r = n + e, a = ends[2 * e], b = ends[2 * e + 1];
+        if (faces_on[e] == 2) {
+            entries.push_back(Eigen::Triplet<GLfloat>(r, a, 0.375f));
+            entries.push_back(Eigen::Triplet<GLfloat>(r, b, 0.375f));
+            entries.push_back(Eigen::Triplet<GLfloat>(r, opposite[2 * e], 0.125f));
+            entries.push_back(Eigen::Triplet<GLfloat>(r, opposite[2 * e + 1], 0.125f));
+        } else {
+            entries.push_back(Eigen::Triplet<GLfloat>(r, a, 0.5f));
+            entries.push_back(Eigen::Triplet<GLfloat>(r, b, 0.5f));
+        }
+    }
+    step.resize(n + ne, n);
+    step.setFromTriplets(entries.begin(), entries.end());
+
+    out.resize(4 * nf);
+    for (GLuint f = 0; f < nf; f++) {
+        const Triangle &t = in[f];
+        GLuint m0 = n + edge_of[3 * f], m1 = n + edge_of[3 * f + 1], m2 = n + edge_of[3 * f + 2];
+
+        out[4 * f]     = Triangle(t.vertex1, m0, m2);
+        out[4 * f + 1] = Triangle(m0, t.vertex2, m1);
+        out[4 * f + 2] = Triangle(m2, m1, t.vertex3);
+        out[4 * f + 3] = Triangle(m0, m1, m2);
+    }
+}
+
+GLboolean Subdivider::build(GLuint n, const vector<Triangle> &coarse, GLuint max_levels)
+{
+    GLuint level = std::min(max_levels, MAX_SUBDIVISION_LEVEL);
+    while (level && ((unsigned long long)coarse.size() << (2 * level)) > SUBDIVISION_FACE_LIMIT)
+        level--;
+
+    unsigned long long key = faceHash(n, coarse);
+    if (n == coarse_count && key == topology && max_levels == requested)
+        return GL_FALSE;
+
+    coarse_count = n;
+    topology = key;
+    requested = max_levels;
+    levels = level;
+
+    // Compose the levels' stencils into one coarse-to-fine map
+    Stencil step;
+    stencil.resize(n, n);
+    stencil.setIdentity();
+    faces = coarse;
+    for (GLuint l = 0; l < levels; l++) {
+        vector<Triangle> finer;
+        refine(stencil.rows(), faces, finer, step);
+        stencil = Stencil(step * stencil);
+        faces.swap(finer);
+    }
+    stencil.makeCompressed();
+    builds++;
+    return GL_TRUE;
+}
+
+GLboolean Subdivider::evaluate(const vector<Vector3f> &coarse, ThreadPool *pool)
+{
+    if (coarse.size() != coarse_count) return GL_FALSE;
+
+    const GLint *outer = stencil.outerIndexPtr(), *inner = stencil.innerIndexPtr();
+    const GLfloat *weight = stencil.valuePtr();
+
+    verts.resize(stencil.rows());
+    auto rows = [&](GLuint begin, GLuint end) {
+        for (GLuint r = begin; r < end; r++) {
+            Vector3f sum(0.0f, 0.0f, 0.0f);
+            for (GLint k = outer[r]; k < outer[r + 1]; k++)
+                sum += weight[k] * coarse[inner[k]];
+            verts[r] = sum;
+        }
+    };
+    if (pool) pool->parallelFor(0, verts.size(), SUBDIVISION_GRAIN, rows);
+    else      rows(0, verts.size());
+    return GL_TRUE;
+}
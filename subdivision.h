@@ -0,0 +1,74 @@
+/**
+ * subdivision.h
+ * This file contains the Subdivider class, Loop subdivision through
+ * precomputed stencils. Every level of Loop's scheme is linear in the
+ * vertex positions, so the refined faces and one sparse matrix mapping
+ * coarse to refined positions are built once per topology; evaluating the
+ * smooth surface after the vertices move is a single sparse
+ * matrix-vector product, split by rows across the pool.
+ */
+
+#ifndef _SUBDIVISION_H_
+#define _SUBDIVISION_H_
+
+#ifdef __APPLE__
+#include <OpenGL/gl.h>
+#else
+#include <GL/gl.h>
+#endif
+
+#include <vector>
+#include <Eigen/Core>
+#include <Eigen/SparseCore>
+#include "mesh.h"
+#include "fairing.h"
+#include "threadpool.h"
+
+using std::vector;
+using Eigen::Vector3f;
+
+const GLuint MAX_SUBDIVISION_LEVEL = 3;
+
+// Levels are dropped until the refined mesh stays under this many faces
+const GLuint SUBDIVISION_FACE_LIMIT = 1 << 22;
+
+class Subdivider
+{
+public:
+    vector<Vector3f> verts;     // refined positions of the last evaluate
+    vector<Triangle> faces;     // refined faces
+    GLuint levels;              // levels actually applied
+    GLuint builds;              // stencil builds since construction
+
+    Subdivider(void)
+        : levels(0), builds(0), requested(0), coarse_count(0), topology(0) {}
+
+    /**
+     * build
+     * Refines the faces of an n vertex mesh up to the given levels and
+     * composes their stencils, unless that was already done for the same
+     * faces and levels.
+     * @return GLboolean - GL_TRUE if the stencils were rebuilt
+     */
+    GLboolean build(GLuint n, const vector<Triangle> &coarse, GLuint max_levels);
+
+    /**
+     * evaluate
+     * Applies the stencils to the coarse positions.
+     * @return GLboolean - GL_FALSE if coarse does not match the last build
+     */
+    GLboolean evaluate(const vector<Vector3f> &coarse, ThreadPool *pool);
+
+private:
+    typedef Eigen::SparseMatrix<GLfloat, Eigen::RowMajor> Stencil;
+
+    Stencil stencil;            // refined x coarse
+    GLuint requested;
+    GLuint coarse_count;
+    unsigned long long topology;
+
+    static void refine(GLuint n, const vector<Triangle> &in, vector<Triangle> &out,
+        Stencil &step);
+};
+
+#endif
@@ -0,0 +1,157 @@
+#include "taskgraph.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+
+static GLdouble now(void)
+{
+    return std::chrono::duration<GLdouble, std::milli>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+GLuint TaskGraph::add(const char *name, Stage stage)
+{
+    Node node;
+    node.name = name;
+    node.stage = std::move(stage);
+    node.predecessors = 0;
+    node.enabled = GL_TRUE;
+    node.ran = GL_FALSE;
+    node.start_ms = node.ms = 0.0;
+    nodes.push_back(std::move(node));
+    return nodes.size() - 1;
+}
+
+void TaskGraph::depend(GLuint before, GLuint node)
+{
+    if (before == node) return;
+    vector<GLuint> &next = nodes[before].successors;
+    for (GLuint s = 0; s < next.size(); s++)
+        if (next[s] == node) return;
+    next.push_back(node);
+    nodes[node].predecessors++;
+}
+
+void TaskGraph::access(GLuint slot, GLboolean write)
+{
+    GLuint node = nodes.size() - 1;
+    Access &use = accesses[slot];
+
+    (write ? nodes[node].writes : nodes[node].reads).push_back(slot);
+    if (use.writer >= 0) depend(use.writer, node);
+    if (!write) {
+        use.readers.push_back(node);
+        return;
+    }
+
+    // Writing must also wait until earlier stages are done reading
+    for (GLuint r = 0; r < use.readers.size(); r++)
+        depend(use.readers[r], node);
+    use.readers.clear();
+    use.writer = node;
+}
+
+/**
+ * use
+ * The object bound to slot, for node. Using a slot the stage did not
+ * declare, or writing one it only reads, is reported; the stage would
+ * race with the stages it was not ordered against.
+ */
+void *TaskGraph::use(GLuint node, GLuint slot, GLboolean write) const
+{
+    const Node &stage = nodes[node];
+    GLboolean writes = std::count(stage.writes.begin(), stage.writes.end(), slot) > 0;
+    GLboolean reads = std::count(stage.reads.begin(), stage.reads.end(), slot) > 0;
+
+    if (!writes && (write || !reads))
+        std::cerr << "TASKGRAPH::" << stage.name << "::UNDECLARED "
+                  << (write ? "WRITE" : "READ") << " OF SLOT " << slot << std::endl;
+    return accesses[slot].object;
+}
+
+GLboolean TaskGraph::run(ThreadPool *pool, Cancelled cancelled)
+{
+    GLuint n = nodes.size();
+
+    for (GLuint i = 0; i < n; i++) {
+        if (!nodes[i].enabled) continue;
+        const vector<GLuint> *lists[2] = { &nodes[i].reads, &nodes[i].writes };
+        for (GLuint l = 0; l < 2; l++)
+            for (GLuint k = 0; k < lists[l]->size(); k++)
+                if (!accesses[(*lists[l])[k]].object) {
+                    std::cerr << "TASKGRAPH::" << nodes[i].name << "::UNBOUND SLOT "
+                              << (*lists[l])[k] << std::endl;
+                    return GL_FALSE;
+                }
+    }
+
+    stop = std::move(cancelled);
+    stopped = GL_FALSE;
+    origin = now();
+
+    if (!pool) {
+        for (GLuint i = 0; i < n; i++)
+            execute(i, NULL, NULL);
+    } else {
+        if (waiting.size() != n)
+            waiting = vector<std::atomic<GLint> >(n);
+        for (GLuint i = 0; i < n; i++)
+            waiting[i] = nodes[i].predecessors;
+
+        TaskGroup group;
+        for (GLuint i = 0; i < n; i++)
+            if (!nodes[i].predecessors)
+                pool->submit(group, [this, i, pool, &group]() { execute(i, pool, &group); });
+        pool->wait(group);
+    }
+
+    wall_ms = now() - origin;
+    work_ms = 0.0;
+    for (GLuint i = 0; i < n; i++)
+        work_ms += nodes[i].ms;
+    runs++;
+    stop = Cancelled();
+    return !stopped;
+}
+
+void TaskGraph::execute(GLuint i, ThreadPool *pool, TaskGroup *group)
+{
+    Node &node = nodes[i];
+    node.ran = GL_FALSE;
+    node.start_ms = node.ms = 0.0;
+
+    if (!stopped && stop && stop()) stopped = GL_TRUE;
+    if (node.enabled && !stopped) {
+        Data data;
+        data.graph = this;
+        data.node = i;
+
+        GLdouble start = now();
+        node.stage(data);
+        node.start_ms = start - origin;
+        node.ms = now() - start;
+        node.ran = GL_TRUE;
+    }
+
+    if (!pool) return;
+    for (GLuint s = 0; s < node.successors.size(); s++) {
+        GLuint next = node.successors[s];
+        if (--waiting[next] == 0)
+            pool->submit(*group, [this, next, pool, group]() { execute(next, pool, group); });
+    }
+}
+
+void TaskGraph::print(const char *title) const
+{
+    printf("%s: %.3f ms, %.3f ms in stages%s\n", title, wall_ms, work_ms,
+           stopped ? ", cancelled" : "");
+    for (GLuint i = 0; i < nodes.size(); i++) {
+        const Node &node = nodes[i];
+        if (node.ran)
+            printf("  %-12s %8.3f ms  at %8.3f ms\n", node.name, node.ms, node.start_ms);
+        else
+            printf("  %-12s %8s\n", node.name, "skipped");
+    }
+}
@@ -0,0 +1,188 @@
+/**
+ * taskgraph.h
+ * This file contains the TaskGraph class, which runs a set of stages in
+ * dependency order on the work-stealing ThreadPool. The data of a graph are
+ * typed slots, and every stage declares the slots it reads and writes
+ * right after it is added. A stage then waits for the last earlier stage
+ * that wrote anything it touches, and a writing stage also waits for the
+ * earlier readers. Running the graph therefore gives the same results as
+ * running the stages in the order they were added, while stages with
+ * disjoint data overlap. A graph is built once and run any number of
+ * times, each run over the objects its slots are bound to, and keeps the
+ * timing of its last run. Stages reach their data only through the slots
+ * they declared.
+ */
+
+#ifndef _TASKGRAPH_H_
+#define _TASKGRAPH_H_
+
+#ifdef __APPLE__
+#include <OpenGL/gl.h>
+#else
+#include <GL/gl.h>
+#endif
+
+#include <atomic>
+#include <functional>
+#include <vector>
+#include "threadpool.h"
+
+using std::vector;
+
+class TaskGraph
+{
+public:
+    /**
+     * Slot class
+     * Handle of one datum of type T; only an object of that type can be
+     * bound to it.
+     */
+    template <class T>
+    class Slot
+    {
+    public:
+        Slot(void) : id(0) {}
+    private:
+        friend class TaskGraph;
+        GLuint id;
+    };
+
+    /**
+     * Data class
+     * A running stage's view of its slots: in for the ones it declared,
+     * out for the ones it declared writing.
+     */
+    class Data
+    {
+    public:
+        template <class T>
+        const T &in(Slot<T> slot) const
+            { return *static_cast<T *>(graph->use(node, slot.id, GL_FALSE)); }
+        template <class T>
+        T &out(Slot<T> slot) const
+            { return *static_cast<T *>(graph->use(node, slot.id, GL_TRUE)); }
+    private:
+        friend class TaskGraph;
+        const TaskGraph *graph;
+        GLuint node;
+    };
+
+    typedef std::function<void(const Data &)> Stage;
+    typedef std::function<GLboolean(void)> Cancelled;
+
+    /**
+     * Node struct
+     * A stage, the stages waiting on it, and the timing of its last run.
+     */
+    struct Node {
+        const char    *name;
+        Stage          stage;
+        vector<GLuint> reads, writes;   // slot ids
+        vector<GLuint> successors;
+        GLuint         predecessors;
+        GLboolean      enabled;
+        GLboolean      ran;         // false if disabled or cancelled
+        GLdouble       start_ms;    // from the start of the run
+        GLdouble       ms;
+    };
+
+    vector<Node> nodes;
+
+    // Last run: wall time, and the time summed over the stages that ran
+    GLdouble wall_ms, work_ms;
+    GLuint runs;
+
+    TaskGraph(void)
+        : wall_ms(0.0), work_ms(0.0), runs(0), stopped(GL_FALSE), origin(0.0) {}
+
+    /**
+     * slot
+     * Declares a datum of type T.
+     * @return Slot<T> - its handle, unbound
+     */
+    template <class T>
+    Slot<T> slot(void)
+    {
+        Slot<T> fresh;
+        fresh.id = accesses.size();
+        Access use = {NULL, -1, vector<GLuint>()};
+        accesses.push_back(use);
+        return fresh;
+    }
+
+    /**
+     * bind
+     * Makes object the datum of slot for the following runs.
+     */
+    template <class T>
+    void bind(Slot<T> slot, T &object)
+        { accesses[slot.id].object = &object; }
+
+    /**
+     * add
+     * Appends a stage that runs after every stage it depends on.
+     * @return GLuint - the stage's node index
+     */
+    GLuint add(const char *name, Stage stage);
+
+    /**
+     * reads & writes
+     * Declare slots of the last added stage; stages are ordered on them.
+     */
+    template <class T>
+    void reads(Slot<T> slot)
+        { access(slot.id, GL_FALSE); }
+    template <class T>
+    void writes(Slot<T> slot)
+        { access(slot.id, GL_TRUE); }
+
+    /**
+     * enable
+     * Disabled stages are skipped, and the stages waiting on them run as
+     * if they had finished.
+     */
+    void enable(GLuint node, GLboolean on)
+        { nodes[node].enabled = on; }
+
+    /**
+     * run
+     * Runs every enabled stage once, on pool or, without one, on the
+     * calling thread in the order the stages were added. Stages that have
+     * not started once cancelled returns true are skipped.
+     * @return GLboolean - GL_FALSE if the run was cancelled, or nothing
+     *                     ran because an enabled stage uses an unbound slot
+     */
+    GLboolean run(ThreadPool *pool, Cancelled cancelled = Cancelled());
+
+    /**
+     * print
+     * Prints the timing of the last run: every stage's start and duration,
+     * and the wall time against the stage time, whose ratio is the overlap.
+     */
+    void print(const char *title) const;
+
+private:
+    /**
+     * Access struct
+     * The object bound to one slot, the last stage declared writing it, and
+     * the stages declared reading it since.
+     */
+    struct Access {
+        void          *object;
+        GLint          writer;
+        vector<GLuint> readers;
+    };
+
+    vector<Access> accesses;                // per slot
+    vector<std::atomic<GLint> > waiting;   // unfinished predecessors per stage
+    std::atomic<GLboolean> stopped;
+    Cancelled stop;
+    GLdouble origin;                        // run start, in ms
+
+    void access(GLuint slot, GLboolean write);
+    void *use(GLuint node, GLuint slot, GLboolean write) const;
+    void depend(GLuint before, GLuint node);
+    void execute(GLuint node, ThreadPool *pool, TaskGroup *group);
+};
+
+#endif
@@ -0,0 +1,138 @@
+#include "threadpool.h"
+
+// Index of the worker running on this thread, -1 outside the pool
+static thread_local GLint worker_index = -1;
+static thread_local const ThreadPool *worker_pool = NULL;
+
+ThreadPool::ThreadPool(GLuint threads)
+    :queued(0), next(0), stopping(GL_FALSE)
+{
+    if (threads == 0) threads = std::thread::hardware_concurrency();
+    if (threads == 0) threads = 1;
+
+    for (GLuint i = 0; i < threads; i++)
+        workers.push_back(new Worker);
+    for (GLuint i = 0; i < threads; i++)
+        workers[i]->thread = std::thread(&ThreadPool::run, this, i);
+}
+
+ThreadPool::~ThreadPool(void)
+{
+    {
+        std::lock_guard<std::mutex> guard(sleep_lock);
+        stopping = GL_TRUE;
+    }
+    wake.notify_all();
+
+    for (GLuint i = 0; i < workers.size(); i++) {
+        workers[i]->thread.join();
+        delete workers[i];
+    }
+}
+
+void ThreadPool::submit(TaskGroup &group, Task task)
+{
+    GLuint target = (worker_pool == this) ? (GLuint)worker_index
+                                          : next++ % workers.size();
+    Worker *w = workers[target];
+
+    group.pending++;
+    {
+        std::lock_guard<std::mutex> guard(w->lock);
+        w->jobs.push_back(Job{std::move(task), &group});
+    }
+    queued++;
+
+    // Taking the lock orders this wakeup after a sleeper's predicate check
+    { std::lock_guard<std::mutex> guard(sleep_lock); }
+    wake.notify_one();
+}
+
+void ThreadPool::wait(TaskGroup &group)
+{
+    GLint self = (worker_pool == this) ? worker_index : -1;
+
+    while (group.pending > 0)
+        if (!runOne(self))
+            std::this_thread::yield();
+}
+
+void ThreadPool::parallelFor(GLuint first, GLuint last, GLuint grain,
+    const std::function<void(GLuint, GLuint)> &body)
+{
+    if (first >= last) return;
+    if (grain == 0) grain = 1;
+
+    // Too little work to be worth queueing
+    if (last - first <= grain) {
+        body(first, last);
+        return;
+    }
+
+    TaskGroup group;
+    for (GLuint begin = first; begin < last; begin += grain) {
+        GLuint end = (last - begin > grain) ? begin + grain : last;
+        submit(group, [&body, begin, end]() { body(begin, end); });
+    }
+    wait(group);
+}
+
+void ThreadPool::run(GLuint self)
+{
+    worker_index = self;
+    worker_pool  = this;
+
+    for (;;) {
+        if (runOne(self)) continue;
+
+        std::unique_lock<std::mutex> guard(sleep_lock);
+        wake.wait(guard, [this]() { return queued > 0 || stopping; });
+        if (stopping && queued == 0) return;
+    }
+}
+
+/**
+ * runOne
+ * Runs one job, preferring the caller's own deque. Returns GL_FALSE if
+ * every deque was empty.
+ */
+GLboolean ThreadPool::runOne(GLint self)
+{
+    Job job;
+
+    if (!(self >= 0 && pop(self, job)) && !steal(self < 0 ? 0 : self, job))
+        return GL_FALSE;
+
+    job.task();
+    job.group->pending--;
+    return GL_TRUE;
+}
+
+GLboolean ThreadPool::pop(GLuint self, Job &job)
+{
+    Worker *w = workers[self];
+    std::lock_guard<std::mutex> guard(w->lock);
+
+    if (w->jobs.empty()) return GL_FALSE;
+    job = std::move(w->jobs.back());
+    w->jobs.pop_back();
+    queued--;
+    return GL_TRUE;
+}
+
+GLboolean ThreadPool::steal(GLuint self, Job &job)
+{
+    GLuint n = workers.size();
+
+    for (GLuint k = 1; k <= n; k++) {
+        Worker *w = workers[(self + k) % n];
+        std::lock_guard<std::mutex> guard(w->lock);
+
+        if (w->jobs.empty()) continue;
+        job = std::move(w->jobs.front());
+        w->jobs.pop_front();
+        queued--;
+        return GL_TRUE;
+    }
+    return GL_FALSE;
+}
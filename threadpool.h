@@ -0,0 +1,100 @@
+/**
+ * threadpool.h
+ * This file contains the ThreadPool class, a fixed set of worker threads
+ * that share work by stealing. Every worker owns a task deque: it pushes
+ * and pops at the back, while idle workers steal from the front of the
+ * others. Threads that wait on a TaskGroup run queued tasks meanwhile, so
+ * groups may be waited on from inside tasks.
+ */
+
+#ifndef _THREADPOOL_H_
+#define _THREADPOOL_H_
+
+#ifdef __APPLE__
+#include <OpenGL/gl.h>
+#else
+#include <GL/gl.h>
+#endif
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using std::vector;
+
+/**
+ * TaskGroup struct
+ * Counts the unfinished tasks submitted under it.
+ */
+struct TaskGroup {
+    std::atomic<GLint> pending;
+
+    TaskGroup(void) : pending(0) {}
+};
+
+class ThreadPool
+{
+public:
+    typedef std::function<void(void)> Task;
+
+    /**
+     * ThreadPool
+     * @param GLuint threads - worker count, 0 for one per hardware thread
+     */
+    ThreadPool(GLuint threads = 0);
+    ~ThreadPool(void);
+
+    /**
+     * submit
+     * Queues task under group. Workers push to their own deque, other
+     * threads spread tasks over the workers round-robin.
+     */
+    void submit(TaskGroup &group, Task task);
+
+    /**
+     * wait
+     * Runs queued tasks on the calling thread until group has finished.
+     */
+    void wait(TaskGroup &group);
+
+    /**
+     * parallelFor
+     * Calls body(begin, end) over consecutive slices of [first, last) of at
+     * most grain items each, and returns once every slice has run.
+     */
+    void parallelFor(GLuint first, GLuint last, GLuint grain,
+        const std::function<void(GLuint, GLuint)> &body);
+
+    GLuint size(void) const
+        { return workers.size(); }
+
+private:
+    struct Job {
+        Task       task;
+        TaskGroup *group;
+    };
+
+    struct Worker {
+        std::deque<Job> jobs;
+        std::mutex      lock;
+        std::thread     thread;
+    };
+
+    vector<Worker *>        workers;
+    std::atomic<GLint>      queued;     // jobs sitting in any deque
+    std::atomic<GLuint>     next;       // round-robin target for outsiders
+    std::atomic<GLboolean>  stopping;
+    std::mutex              sleep_lock;
+    std::condition_variable wake;
+
+    void run(GLuint self);
+    GLboolean pop(GLuint self, Job &job);
+    GLboolean steal(GLuint self, Job &job);
+    GLboolean runOne(GLint self);
+};
+
+#endif
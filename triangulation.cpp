@@ -0,0 +1,616 @@
+#include "triangulation.h"
+
+#include <algorithm>
+#include <cmath>
+
+#define NEXT(i) (((i) + 1) % 3)
+#define PREV(i) (((i) + 2) % 3)
+
+/**
+ * hilbertKey
+ * Maps a point on a 2^16 x 2^16 grid to its distance along a Hilbert curve.
+ * Inserting points in this order keeps the point location walk short.
+ */
+static GLuint hilbertKey(GLuint x, GLuint y)
+{
+    const GLuint n = 1u << 16;
+    GLuint rx, ry, d = 0;
+
+    for (GLuint s = n / 2; s > 0; s /= 2) {
+        rx = (x & s) > 0;
+        ry = (y & s) > 0;
+        d += s * s * ((3 * rx) ^ ry);
+        if (ry == 0) {
+            if (rx == 1) {
+                x = n - 1 - x;
+                y = n - 1 - y;
+            }
+            std::swap(x, y);
+        }
+    }
+    return d;
+}
+
+void Triangulation::clear(void)
+{
+    points.clear();
+    outline.clear();
+    triangles.clear();
+    neighbors.clear();
+    failed_constraints = 0;
+    crossings = 0;
+}
+
+GLboolean Triangulation::triangulate(const vector<Vector3f> &curve)
+{
+    GLint n = curve.size();
+    GLint i;
+
+    clear();
+    if (n < 3) return GL_FALSE;
+
+    // Copy outline into working storage and compute its bounds
+    pts.resize(n + 3);
+    GLdouble minx = curve[0].x(), maxx = minx;
+    GLdouble miny = curve[0].y(), maxy = miny;
+    for (i = 0; i < n; i++) {
+        if (!std::isfinite(curve[i].x()) || !std::isfinite(curve[i].y()))
+            return GL_FALSE;
+        pts[i].x = curve[i].x();
+        pts[i].y = curve[i].y();
+        minx = std::min(minx, (GLdouble)pts[i].x); maxx = std::max(maxx, (GLdouble)pts[i].x);
+        miny = std::min(miny, (GLdouble)pts[i].y); maxy = std::max(maxy, (GLdouble)pts[i].y);
+    }
+
+    // Enclosing super triangle, counter-clockwise
+    GLdouble cx = (minx + maxx) / 2, cy = (miny + maxy) / 2;
+    GLdouble D  = std::max(std::max(maxx - minx, maxy - miny), 1.0);
+    pts[n].x     = cx - 10 * D;  pts[n].y     = cy - 10 * D;
+    pts[n + 1].x = cx + 10 * D;  pts[n + 1].y = cy - 10 * D;
+    pts[n + 2].x = cx;           pts[n + 2].y = cy + 10 * D;
+
+    tv.clear(); tn.clear(); tc.clear();
+    tv.reserve(6 * n + 3); tn.reserve(6 * n + 3); tc.reserve(6 * n + 3);
+    vtri.assign(n + 3, -1);
+    tv.resize(3); tn.resize(3); tc.resize(3);
+    setTri(0, n, n + 1, n + 2, -1, -1, -1);
+    tc[0] = tc[1] = tc[2] = 0;
+    last = 0;
+
+    // Insert every vertex; exact duplicates collapse onto the first copy
+    sortPoints(n);
+    outline.resize(n);
+    for (i = 0; i < n; i++)
+        outline[order[i]] = insertPoint(order[i]);
+
+    // Recover the outline edges. Crossing edges are split rather than
+    // flipped, so an edge once recovered stays
+    for (i = 0; i < n; i++) {
+        GLint a = outline[i], b = outline[(i + 1) % n];
+        if (a != b && !insertConstraint(a, b, 0))
+            failed_constraints++;
+    }
+
+    extractInterior(n);
+    return (triangles.size() > 0);
+}
+
+/********* PREDICATES ***************/
+GLdouble Triangulation::orient(GLint a, GLint b, GLint c) const
+{
+    return ((GLdouble)pts[b].x - pts[a].x) * ((GLdouble)pts[c].y - pts[a].y)
+         - ((GLdouble)pts[b].y - pts[a].y) * ((GLdouble)pts[c].x - pts[a].x);
+}
+
+GLdouble Triangulation::incircle(GLint a, GLint b, GLint c, GLint d) const
+{
+    GLdouble adx = (GLdouble)pts[a].x - pts[d].x, ady = (GLdouble)pts[a].y - pts[d].y;
+    GLdouble bdx = (GLdouble)pts[b].x - pts[d].x, bdy = (GLdouble)pts[b].y - pts[d].y;
+    GLdouble cdx = (GLdouble)pts[c].x - pts[d].x, cdy = (GLdouble)pts[c].y - pts[d].y;
+
+    GLdouble alift = adx * adx + ady * ady;
+    GLdouble blift = bdx * bdx + bdy * bdy;
+    GLdouble clift = cdx * cdx + cdy * cdy;
+
+    return alift * (bdx * cdy - cdx * bdy)
+         + blift * (cdx * ady - adx * cdy)
+         + clift * (adx * bdy - bdx * ady);
+}
+
+/********* TOPOLOGY HELPERS *********/
+void Triangulation::setTri(GLint t, GLint a, GLint b, GLint c,
+    GLint na, GLint nb, GLint nc)
+{
+    tv[3*t] = a;  tv[3*t + 1] = b;  tv[3*t + 2] = c;
+    tn[3*t] = na; tn[3*t + 1] = nb; tn[3*t + 2] = nc;
+    vtri[a] = vtri[b] = vtri[c] = t;
+}
+
+void Triangulation::relink(GLint t, GLint from, GLint to)
+{
+    if (t < 0) return;
+    for (GLint i = 0; i < 3; i++) {
+        if (tn[3*t + i] == from) {
+            tn[3*t + i] = to;
+            return;
+        }
+    }
+}
+
+GLint Triangulation::edgeIndex(GLint t, GLint a, GLint b) const
+{
+    for (GLint i = 0; i < 3; i++)
+        if (tv[3*t + i] == a && tv[3*t + NEXT(i)] == b)
+            return i;
+    return -1;
+}
+
+GLboolean Triangulation::findEdge(GLint a, GLint b, GLint &t, GLint &i) const
+{
+    GLint start = vtri[a], k;
+
+    // Rotate around a through the edges ending at a
+    t = start;
+    do {
+        for (k = 0; tv[3*t + k] != a; k++);
+        if (tv[3*t + NEXT(k)] == b) {
+            i = k;
+            return GL_TRUE;
+        }
+        t = tn[3*t + PREV(k)];
+    } while (t >= 0 && t != start);
+    if (t == start) return GL_FALSE;
+
+    // Hit the hull, so finish the fan in the other direction
+    t = start;
+    for (;;) {
+        for (k = 0; tv[3*t + k] != a; k++);
+        t = tn[3*t + k];
+        if (t < 0) return GL_FALSE;
+        for (k = 0; tv[3*t + k] != a; k++);
+        if (tv[3*t + NEXT(k)] == b) {
+            i = k;
+            return GL_TRUE;
+        }
+    }
+}
+
+void Triangulation::sortPoints(GLint n)
+{
+    GLdouble minx = pts[0].x, maxx = minx, miny = pts[0].y, maxy = miny;
+    GLint i;
+
+    for (i = 1; i < n; i++) {
+        minx = std::min(minx, (GLdouble)pts[i].x); maxx = std::max(maxx, (GLdouble)pts[i].x);
+        miny = std::min(miny, (GLdouble)pts[i].y); maxy = std::max(maxy, (GLdouble)pts[i].y);
+    }
+    GLdouble scale = 65535.0 / std::max(std::max(maxx - minx, maxy - miny), 1e-9);
+
+    // Biased randomized insertion order: points go into rounds of roughly
+    // doubling size, and each round is Hilbert sorted. Sketch outlines are
+    // nearly convex curves, where a plain spatial order degrades badly.
+    GLuint seed = 0x9e3779b9u;
+    keys.resize(n);
+    for (i = 0; i < n; i++) {
+        GLuint hx = (GLuint)((pts[i].x - minx) * scale);
+        GLuint hy = (GLuint)((pts[i].y - miny) * scale);
+
+        seed ^= seed << 13; seed ^= seed >> 17; seed ^= seed << 5;
+        unsigned long long round = 31 - __builtin_ctz(seed | 0x80000000u);
+
+        keys[i] = (round << 58)
+                | ((unsigned long long)(hilbertKey(hx, hy) >> 6) << 32)
+                | (GLuint)i;
+    }
+    std::sort(keys.begin(), keys.end());
+
+    order.resize(n);
+    for (i = 0; i < n; i++)
+        order[i] = (GLint)(keys[i] & 0xffffffffu);
+}
+
+/********* INCREMENTAL INSERTION ****/
+GLint Triangulation::locate(GLint p, GLint &edge)
+{
+    GLint t = last, steps = 0, i, k;
+    GLint limit = tv.size() / 3 + 3;
+    GLdouble o[3];
+
+    for (;;) {
+        GLint exit = -1, zeros = 0, zero = -1;
+        for (k = 0; k < 3; k++) {
+            i = (k + steps) % 3;
+            o[i] = orient(tv[3*t + i], tv[3*t + NEXT(i)], p);
+            if (o[i] < 0 && exit < 0) exit = i;
+            if (o[i] == 0) { zeros++; zero = i; }
+        }
+
+        if (exit < 0) {
+            edge = (zeros == 0) ? -1 : (zeros == 1) ? zero : -2;
+            return t;
+        }
+
+        t = tn[3*t + exit];
+        if (t < 0 || ++steps > limit) break;
+    }
+
+    // The walk failed to converge, so fall back to a linear scan
+    for (t = 0; t < (GLint)tv.size() / 3; t++) {
+        GLint zeros = 0, zero = -1;
+        for (i = 0; i < 3; i++) {
+            o[i] = orient(tv[3*t + i], tv[3*t + NEXT(i)], p);
+            if (o[i] == 0) { zeros++; zero = i; }
+        }
+        if (o[0] >= 0 && o[1] >= 0 && o[2] >= 0) {
+            edge = (zeros == 0) ? -1 : (zeros == 1) ? zero : -2;
+            return t;
+        }
+    }
+    edge = -3;
+    return -1;
+}
+
+GLint Triangulation::insertPoint(GLint p)
+{
+    GLint e, t = locate(p, e);
+
+    if (t < 0) return p;
+
+    // Point coincides with an existing vertex
+    if (e == -2) {
+        for (GLint k = 0; k < 3; k++) {
+            GLint v = tv[3*t + k];
+            if (pts[v].x == pts[p].x && pts[v].y == pts[p].y)
+                return v;
+        }
+        return p;
+    }
+    return insertAt(p, t, e);
+}
+
+/**
+ * insertAt
+ * Inserts p into triangle t, or onto its edge e unless e is negative. The
+ * halves of a split edge keep its outline count.
+ */
+GLint Triangulation::insertAt(GLint p, GLint t, GLint e)
+{
+    last = t;
+    stack.clear();
+
+    if (e < 0) {
+        // Split the containing triangle into three
+        GLint a = tv[3*t], b = tv[3*t + 1], c = tv[3*t + 2];
+        GLint nab = tn[3*t], nbc = tn[3*t + 1], nca = tn[3*t + 2];
+        unsigned char cab = tc[3*t], cbc = tc[3*t + 1], cca = tc[3*t + 2];
+        GLint t1 = tv.size() / 3, t2 = t1 + 1;
+
+        tv.resize(tv.size() + 6); tn.resize(tn.size() + 6); tc.resize(tc.size() + 6);
+        setTri(t,  a, b, p, nab, t1, t2);
+        setTri(t1, b, c, p, nbc, t2, t);
+        setTri(t2, c, a, p, nca, t, t1);
+        tc[3*t]  = cab; tc[3*t + 1]  = 0; tc[3*t + 2]  = 0;
+        tc[3*t1] = cbc; tc[3*t1 + 1] = 0; tc[3*t1 + 2] = 0;
+        tc[3*t2] = cca; tc[3*t2 + 1] = 0; tc[3*t2 + 2] = 0;
+        relink(nbc, t, t1);
+        relink(nca, t, t2);
+
+        stack.push_back(3*t);
+        stack.push_back(3*t1);
+        stack.push_back(3*t2);
+    } else {
+        // Split the edge shared by t and its neighbor into four triangles
+        GLint a = tv[3*t + e], b = tv[3*t + NEXT(e)], c = tv[3*t + PREV(e)];
+        GLint u = tn[3*t + e];
+        GLint nbc = tn[3*t + NEXT(e)], nca = tn[3*t + PREV(e)];
+        unsigned char cab = tc[3*t + e];
+        unsigned char cbc = tc[3*t + NEXT(e)], cca = tc[3*t + PREV(e)];
+        GLint t2 = tv.size() / 3;
+
+        if (u < 0) {
+            tv.resize(tv.size() + 3); tn.resize(tn.size() + 3); tc.resize(tc.size() + 3);
+            setTri(t,  a, p, c, -1, t2, nca);
+            setTri(t2, p, b, c, -1, nbc, t);
+            tc[3*t]  = cab; tc[3*t + 1]  = 0;   tc[3*t + 2]  = cca;
+            tc[3*t2] = cab; tc[3*t2 + 1] = cbc; tc[3*t2 + 2] = 0;
+            relink(nbc, t, t2);
+
+            stack.push_back(3*t + 2);
+            stack.push_back(3*t2 + 1);
+        } else {
+            GLint j = edgeIndex(u, b, a);
+            GLint d = tv[3*u + PREV(j)];
+            GLint nad = tn[3*u + NEXT(j)], ndb = tn[3*u + PREV(j)];
+            unsigned char cad = tc[3*u + NEXT(j)], cdb = tc[3*u + PREV(j)];
+            GLint u2 = t2 + 1;
+
+            tv.resize(tv.size() + 6); tn.resize(tn.size() + 6); tc.resize(tc.size() + 6);
+            setTri(t,  a, p, c, u,  t2,  nca);
+            setTri(t2, p, b, c, u2, nbc, t);
+            setTri(u,  p, a, d, t,  nad, u2);
+            setTri(u2, b, p, d, t2, u,   ndb);
+            tc[3*t]  = cab; tc[3*t + 1]  = 0;   tc[3*t + 2]  = cca;
+            tc[3*t2] = cab; tc[3*t2 + 1] = cbc; tc[3*t2 + 2] = 0;
+            tc[3*u]  = cab; tc[3*u + 1]  = cad; tc[3*u + 2]  = 0;
+            tc[3*u2] = cab; tc[3*u2 + 1] = 0;   tc[3*u2 + 2] = cdb;
+            relink(nbc, t, t2);
+            relink(ndb, u, u2);
+
+            stack.push_back(3*t + 2);
+            stack.push_back(3*t2 + 1);
+            stack.push_back(3*u + 1);
+            stack.push_back(3*u2 + 2);
+        }
+    }
+
+    legalize();
+    return p;
+}
+
+void Triangulation::legalize(void)
+{
+    while (!stack.empty()) {
+        GLint t = stack.back() / 3, i = stack.back() % 3;
+        stack.pop_back();
+
+        GLint u = tn[3*t + i];
+        if (u < 0 || tc[3*t + i]) continue;
+
+        GLint a = tv[3*t + i], b = tv[3*t + NEXT(i)], c = tv[3*t + PREV(i)];
+        GLint d = tv[3*u + PREV(edgeIndex(u, b, a))];
+
+        if (incircle(a, b, c, d) > 0 &&
+            orient(c, d, a) * orient(c, d, b) < 0) {
+            flip(t, i);
+            // t is now (c, a, d) and u is (d, b, c)
+            stack.push_back(3*t + 1);
+            stack.push_back(3*u);
+        }
+    }
+}
+
+void Triangulation::flip(GLint t, GLint i)
+{
+    GLint a = tv[3*t + i], b = tv[3*t + NEXT(i)], c = tv[3*t + PREV(i)];
+    GLint u = tn[3*t + i];
+    GLint j = edgeIndex(u, b, a);
+    GLint d = tv[3*u + PREV(j)];
+
+    GLint nbc = tn[3*t + NEXT(i)], nca = tn[3*t + PREV(i)];
+    GLint nad = tn[3*u + NEXT(j)], ndb = tn[3*u + PREV(j)];
+    unsigned char cbc = tc[3*t + NEXT(i)], cca = tc[3*t + PREV(i)];
+    unsigned char cad = tc[3*u + NEXT(j)], cdb = tc[3*u + PREV(j)];
+
+    setTri(t, c, a, d, nca, nad, u);
+    setTri(u, d, b, c, ndb, nbc, t);
+    tc[3*t] = cca; tc[3*t + 1] = cad; tc[3*t + 2] = 0;
+    tc[3*u] = cdb; tc[3*u + 1] = cbc; tc[3*u + 2] = 0;
+    relink(nad, u, t);
+    relink(nbc, t, u);
+}
+
+/********* CONSTRAINT RECOVERY ******/
+/**
+ * insertCrossing
+ * Adds a vertex where ab crosses edge e of triangle t, an outline edge,
+ * and splits that edge with it. A vertex that would leave a flat or
+ * inverted triangle is not added; ab then passes through the nearer end
+ * of the edge instead.
+ */
+GLint Triangulation::insertCrossing(GLint a, GLint b, GLint t, GLint e)
+{
+    GLint x = tv[3*t + e], y = tv[3*t + NEXT(e)], c = tv[3*t + PREV(e)];
+    GLint u = tn[3*t + e];
+    GLint d = tv[3*u + PREV(edgeIndex(u, y, x))];
+    GLdouble ox = orient(a, b, x), oy = orient(a, b, y);
+    GLdouble s = ox / (ox - oy);
+    GLint p = pts.size();
+
+    Point2 cross = { (GLfloat)(pts[x].x + s * ((GLdouble)pts[y].x - pts[x].x)),
+                     (GLfloat)(pts[x].y + s * ((GLdouble)pts[y].y - pts[x].y)) };
+    pts.push_back(cross);
+    if (orient(x, p, c) <= 0 || orient(p, y, c) <= 0 ||
+        orient(y, p, d) <= 0 || orient(p, x, d) <= 0) {
+        pts.pop_back();
+        return (s < 0.5) ? x : y;
+    }
+    vtri.push_back(-1);
+    crossings++;
+    return insertAt(p, t, e);
+}
+
+/**
+ * restDepth
+ * Depth of the rest of ab once it continues from c. A rest that starts
+ * nearer to b is no deeper, so however many vertices ab passes through
+ * it cannot recurse forever.
+ */
+GLint Triangulation::restDepth(GLint c, GLint a, GLint b, GLint depth) const
+{
+    GLdouble cx = (GLdouble)pts[b].x - pts[c].x, cy = (GLdouble)pts[b].y - pts[c].y;
+    GLdouble ax = (GLdouble)pts[b].x - pts[a].x, ay = (GLdouble)pts[b].y - pts[a].y;
+    return (cx * cx + cy * cy < ax * ax + ay * ay) ? depth : depth + 1;
+}
+
+GLboolean Triangulation::insertConstraint(GLint a, GLint b, GLint depth)
+{
+    GLint t, i, k, u, j;
+
+    if (a == b) return GL_TRUE;
+    if (depth > 64) return GL_FALSE;
+
+    // Edge already present, so just count it; an edge drawn twice is no
+    // boundary under the even-odd rule
+    if (findEdge(a, b, t, i) || findEdge(b, a, t, i)) {
+        tc[3*t + i]++;
+        u = tn[3*t + i];
+        if (u >= 0)
+            tc[3*u + edgeIndex(u, tv[3*t + NEXT(i)], tv[3*t + i])]++;
+        return GL_TRUE;
+    }
+
+    // Find the triangle around a whose opposite edge crosses ab
+    GLint start = vtri[a], e = -1;
+    t = start;
+    do {
+        for (k = 0; tv[3*t + k] != a; k++);
+        GLint x = tv[3*t + NEXT(k)], y = tv[3*t + PREV(k)];
+        GLdouble ox = orient(a, b, x), oy = orient(a, b, y);
+
+        // A vertex lying on ab splits the constraint in two
+        if (ox == 0 && ((GLdouble)pts[x].x - pts[a].x) * ((GLdouble)pts[b].x - pts[a].x) +
+                       ((GLdouble)pts[x].y - pts[a].y) * ((GLdouble)pts[b].y - pts[a].y) > 0)
+            return insertConstraint(a, x, depth + 1) &&
+                   insertConstraint(x, b, restDepth(x, a, b, depth));
+        if (ox < 0 && oy > 0) {
+            e = NEXT(k);
+            break;
+        }
+        t = tn[3*t + PREV(k)];
+    } while (t >= 0 && t != start);
+    if (e < 0) return GL_FALSE;
+
+    // Walk along ab collecting every crossed edge
+    crossing.clear();
+    for (;;) {
+        // Another outline edge crosses ab, so both pass through a new vertex
+        if (tc[3*t + e]) {
+            GLint c = insertCrossing(a, b, t, e);
+            return insertConstraint(a, c, depth + 1) &&
+                   insertConstraint(c, b, restDepth(c, a, b, depth));
+        }
+
+        GLint x = tv[3*t + e], y = tv[3*t + NEXT(e)];
+        crossing.push_back(x);
+        crossing.push_back(y);
+
+        u = tn[3*t + e];
+        j = edgeIndex(u, y, x);
+        GLint z = tv[3*u + PREV(j)];
+        if (z == b) break;
+
+        GLdouble oz = orient(a, b, z);
+        if (oz == 0)
+            return insertConstraint(a, z, depth + 1) &&
+                   insertConstraint(z, b, restDepth(z, a, b, depth));
+
+        t = u;
+        e = (oz < 0) ? PREV(j) : NEXT(j);
+    }
+
+    // Flip crossing edges until none remain (Sloan, 1993)
+    GLuint head = 0, guard = 0;
+    GLuint limit = 8 * crossing.size() * crossing.size() + 64;
+    created.clear();
+    while (head < crossing.size()) {
+        GLint x = crossing[head], y = crossing[head + 1];
+        head += 2;
+
+        if (!findEdge(x, y, t, i)) return GL_FALSE;
+        u = tn[3*t + i];
+        GLint c = tv[3*t + PREV(i)];
+        GLint d = tv[3*u + PREV(edgeIndex(u, y, x))];
+
+        if (orient(c, d, x) * orient(c, d, y) >= 0) {
+            // Quad is not convex yet, retry after its neighbors move
+            crossing.push_back(x);
+            crossing.push_back(y);
+            if (++guard > limit) return GL_FALSE;
+            continue;
+        }
+
+        flip(t, i);
+        if (c != a && c != b && d != a && d != b &&
+            orient(a, b, c) * orient(a, b, d) < 0 &&
+            orient(c, d, a) * orient(c, d, b) < 0) {
+            crossing.push_back(c);
+            crossing.push_back(d);
+        } else {
+            created.push_back(c);
+            created.push_back(d);
+        }
+    }
+
+    if (!insertConstraint(a, b, depth + 1)) return GL_FALSE;
+
+    // Restore the Delaunay property on the newly created edges
+    GLboolean swapped = GL_TRUE;
+    for (guard = 0; swapped && guard < limit; guard++) {
+        swapped = GL_FALSE;
+        for (k = 0; k < (GLint)created.size(); k += 2) {
+            GLint x = created[k], y = created[k + 1];
+            if ((x == a && y == b) || (x == b && y == a)) continue;
+            if (!findEdge(x, y, t, i) && !findEdge(y, x, t, i)) continue;
+            if (tc[3*t + i] || (u = tn[3*t + i]) < 0) continue;
+
+            GLint p = tv[3*t + i], q = tv[3*t + NEXT(i)];
+            GLint c = tv[3*t + PREV(i)];
+            GLint d = tv[3*u + PREV(edgeIndex(u, q, p))];
+            if (incircle(p, q, c, d) > 0 &&
+                orient(c, d, p) * orient(c, d, q) < 0) {
+                flip(t, i);
+                created[k] = c;
+                created[k + 1] = d;
+                swapped = GL_TRUE;
+            }
+        }
+    }
+    return GL_TRUE;
+}
+
+/********* OUTPUT *******************/
+void Triangulation::extractInterior(GLint n)
+{
+    GLint ntri = tv.size() / 3, t, i, count = 0;
+
+    // Flood from the super triangle, switching between outside (-1) and
+    // inside (-3) at every edge drawn an odd number of times. Every
+    // outline edge is present, so this is the even-odd rule.
+    remap.assign(ntri, -2);
+    stack.clear();
+    for (t = 0; t < ntri; t++) {
+        if (isSuper(tv[3*t], n) || isSuper(tv[3*t + 1], n) || isSuper(tv[3*t + 2], n)) {
+            remap[t] = -1;
+            stack.push_back(t);
+        }
+    }
+    while (!stack.empty()) {
+        t = stack.back();
+        stack.pop_back();
+        for (i = 0; i < 3; i++) {
+            GLint u = tn[3*t + i];
+            if (u >= 0 && remap[u] == -2) {
+                GLboolean inside = (remap[t] == -3) != (tc[3*t + i] & 1);
+                remap[u] = inside ? -3 : -1;
+                stack.push_back(u);
+            }
+        }
+    }
+    for (t = 0; t < ntri; t++)
+        remap[t] = (remap[t] == -3) ? count++ : -1;
+
+    // Compact the vertex list, dropping duplicates and the super triangle
+    order.assign(pts.size(), -1);
+    points.clear();
+    for (i = 0; i < (GLint)pts.size(); i++) {
+        if ((i < n && outline[i] == i) || i >= n + 3) {
+            order[i] = points.size();
+            points.push_back(Vector2f(pts[i].x, pts[i].y));
+        }
+    }
+    for (i = 0; i < n; i++)
+        outline[i] = order[outline[i]];
+
+    triangles.resize(count);
+    neighbors.resize(3 * count);
+    for (t = 0; t < ntri; t++) {
+        GLint r = remap[t];
+        if (r < 0) continue;
+        triangles[r] = Triangle(order[tv[3*t]], order[tv[3*t + 1]],
+                                order[tv[3*t + 2]]);
+        for (i = 0; i < 3; i++) {
+            GLint u = tn[3*t + i];
+            neighbors[3*r + i] = (u >= 0) ? remap[u] : -1;
+        }
+    }
+}
@@ -0,0 +1,117 @@
+/**
+ * triangulation.h
+ * This file contains the Triangulation class, which computes the constrained
+ * Delaunay triangulation of the closed sketch outline, as described in the
+ * Teddy paper. The result is stored as flat index arrays with triangle
+ * adjacency so later stages (spine extraction, inflation) can walk it.
+ */
+
+#ifndef _TRIANGULATION_H_
+#define _TRIANGULATION_H_
+
+#ifdef __APPLE__
+#include <OpenGL/gl.h>
+#else
+#include <GL/gl.h>
+#endif
+
+#include <vector>
+#include <Eigen/Core>
+#include "mesh.h"
+
+using std::vector;
+using Eigen::Vector2f;
+using Eigen::Vector3f;
+
+class Triangulation
+{
+public:
+    // Triangulation Data
+    vector<Vector2f> points;      // outline vertices, duplicates removed,
+                                  // then the crossing vertices
+    vector<GLint>    outline;     // outline index -> index into points
+    vector<Triangle> triangles;   // interior triangles, counter-clockwise
+    vector<GLint>    neighbors;   // 3 per triangle, -1 across the outline
+
+    // Constructors
+    Triangulation(void) : failed_constraints(0), crossings(0) {}
+
+    /**
+     * triangulate
+     * @param vector<Vector3f> outline - closed polygon, last vertex joins first
+     * Builds the constrained Delaunay triangulation of the polygon interior.
+     * Edge i of triangle t runs from its i-th to its (i+1)-th vertex, and
+     * neighbors[3*t+i] is the triangle across that edge. Outline edges
+     * that cross another are split by a vertex added at the crossing, and
+     * the triangles are chosen by the even-odd rule.
+     * @return GLboolean - GL_FALSE if no interior triangle was found
+     */
+    GLboolean triangulate(const vector<Vector3f> &outline);
+
+    /**
+     * clear
+     * Empties the triangulation while keeping allocated storage.
+     */
+    void clear(void);
+
+    GLuint size(void) const
+        { return triangles.size(); }
+
+    GLboolean isOutline(GLuint t, GLuint e) const
+        { return neighbors[3*t + e] < 0; }
+
+    GLuint vertex(GLuint t, GLuint i) const
+    {
+        const Triangle &tri = triangles[t];
+        return i == 0 ? tri.vertex1 : (i == 1 ? tri.vertex2 : tri.vertex3);
+    }
+
+    // Number of outline edges missing from the triangulation; only
+    // degenerate input, such as overlapping edges, loses any
+    GLuint failed_constraints;
+
+    // Number of vertices added where outline edges cross
+    GLuint crossings;
+
+private:
+    // Float, as points stores them, so a crossing vertex is tested where it
+    // will end up; the predicates evaluate in double, where orient is exact
+    struct Point2 { GLfloat x, y; };
+
+    // Working triangulation, including the enclosing super triangle
+    vector<Point2>        pts;
+    vector<GLint>         tv;      // 3 vertices per triangle
+    vector<GLint>         tn;      // 3 neighbors per triangle
+    vector<unsigned char> tc;      // 3 outline edge counts per triangle
+    vector<GLint>         vtri;    // one incident triangle per vertex
+    vector<GLint>         order;   // insertion order
+    vector<GLint>         stack;   // legalization work list
+    vector<GLint>         remap;   // working -> output triangle index
+    vector<GLint>         crossing;  // edges crossed by a constraint
+    vector<GLint>         created;   // edges created by constraint flips
+    vector<unsigned long long> keys; // Hilbert sort keys
+    GLint                 last;    // last located triangle
+
+    GLdouble orient(GLint a, GLint b, GLint c) const;
+    GLdouble incircle(GLint a, GLint b, GLint c, GLint d) const;
+
+    void  setTri(GLint t, GLint a, GLint b, GLint c, GLint na, GLint nb, GLint nc);
+    void  relink(GLint t, GLint from, GLint to);
+    GLint edgeIndex(GLint t, GLint a, GLint b) const;
+    GLint locate(GLint p, GLint &edge);
+    GLint insertPoint(GLint p);
+    GLint insertAt(GLint p, GLint t, GLint e);
+    GLint insertCrossing(GLint a, GLint b, GLint t, GLint e);
+    void  legalize(void);
+    void  flip(GLint t, GLint i);
+    GLboolean findEdge(GLint a, GLint b, GLint &t, GLint &i) const;
+    GLboolean insertConstraint(GLint a, GLint b, GLint depth);
+    GLint     restDepth(GLint c, GLint a, GLint b, GLint depth) const;
+    void  sortPoints(GLint n);
+    void  extractInterior(GLint n);
+
+    GLboolean isSuper(GLint v, GLint n) const
+        { return v >= n && v < n + 3; }
+};
+
+#endif
@@ -0,0 +1,204 @@
+#include "vertexarray.h"
+
+#include <cfloat>
+#include <cmath>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define VERTEX_SSE
+#endif
+
+void VertexArray::resize(GLuint n)
+{
+    GLuint padded = (n + VERTEX_PAD - 1) / VERTEX_PAD * VERTEX_PAD;
+
+    // Clear lanes that drop out of range so the padding stays zero
+    for (GLuint i = n; i < count; i++)
+        x[i] = y[i] = z[i] = 0.0f;
+
+    count = n;
+    x.resize(padded, 0.0f);
+    y.resize(padded, 0.0f);
+    z.resize(padded, 0.0f);
+}
+
+void VertexArray::assign(const vector<Vector3f> &verts)
+{
+    resize(verts.size());
+    for (GLuint i = 0; i < count; i++) {
+        x[i] = verts[i].x();
+        y[i] = verts[i].y();
+        z[i] = verts[i].z();
+    }
+}
+
+void VertexArray::copyTo(vector<Vector3f> &verts) const
+{
+    verts.resize(count);
+    for (GLuint i = 0; i < count; i++)
+        verts[i] = Vector3f(x[i], y[i], z[i]);
+}
+
+void VertexArray::transform(const Matrix4f &m)
+{
+    GLfloat *px = x.data(), *py = y.data(), *pz = z.data();
+    GLuint n = padded(), i = 0;
+
+#ifdef VERTEX_SSE
+    __m128 m00 = _mm_set1_ps(m(0, 0)), m01 = _mm_set1_ps(m(0, 1)), m02 = _mm_set1_ps(m(0, 2)), m03 = _mm_set1_ps(m(0, 3));
+    __m128 m10 = _mm_set1_ps(m(1, 0)), m11 = _mm_set1_ps(m(1, 1)), m12 = _mm_set1_ps(m(1, 2)), m13 = _mm_set1_ps(m(1, 3));
+    __m128 m20 = _mm_set1_ps(m(2, 0)), m21 = _mm_set1_ps(m(2, 1)), m22 = _mm_set1_ps(m(2, 2)), m23 = _mm_set1_ps(m(2, 3));
+
+    for (; i < n; i += 4) {
+        __m128 X = _mm_load_ps(px + i), Y = _mm_load_ps(py + i), Z = _mm_load_ps(pz + i);
+
+        _mm_store_ps(px + i, _mm_add_ps(_mm_add_ps(_mm_mul_ps(m00, X), _mm_mul_ps(m01, Y)),
+                                        _mm_add_ps(_mm_mul_ps(m02, Z), m03)));
+        _mm_store_ps(py + i, _mm_add_ps(_mm_add_ps(_mm_mul_ps(m10, X), _mm_mul_ps(m11, Y)),
+                                        _mm_add_ps(_mm_mul_ps(m12, Z), m13)));
+        _mm_store_ps(pz + i, _mm_add_ps(_mm_add_ps(_mm_mul_ps(m20, X), _mm_mul_ps(m21, Y)),
+                                        _mm_add_ps(_mm_mul_ps(m22, Z), m23)));
+    }
+#endif
+    for (; i < n; i++) {
+        GLfloat vx = px[i], vy = py[i], vz = pz[i];
+        px[i] = m(0, 0) * vx + m(0, 1) * vy + m(0, 2) * vz + m(0, 3);
+        py[i] = m(1, 0) * vx + m(1, 1) * vy + m(1, 2) * vz + m(1, 3);
+        pz[i] = m(2, 0) * vx + m(2, 1) * vy + m(2, 2) * vz + m(2, 3);
+    }
+
+    // The translation leaked into the padding, so zero it again
+    for (i = count; i < n; i++)
+        px[i] = py[i] = pz[i] = 0.0f;
+}
+
+void VertexArray::bounds(Vector3f &lo, Vector3f &hi) const
+{
+    const GLfloat *c[3] = { x.data(), y.data(), z.data() };
+
+    for (GLuint k = 0; k < 3; k++) {
+        const GLfloat *p = c[k];
+        GLfloat mn = FLT_MAX, mx = -FLT_MAX;
+        GLuint i = 0;
+
+#ifdef VERTEX_SSE
+        // Padding lanes are zero, so only whole blocks below count are safe
+        __m128 vmn = _mm_set1_ps(FLT_MAX), vmx = _mm_set1_ps(-FLT_MAX);
+        for (; i + 4 <= count; i += 4) {
+            __m128 v = _mm_load_ps(p + i);
+            vmn = _mm_min_ps(vmn, v);
+            vmx = _mm_max_ps(vmx, v);
+        }
+        alignas(16) GLfloat lanes_mn[4], lanes_mx[4];
+        _mm_store_ps(lanes_mn, vmn);
+        _mm_store_ps(lanes_mx, vmx);
+        for (GLuint l = 0; l < 4; l++) {
+            mn = fminf(mn, lanes_mn[l]);
+            mx = fmaxf(mx, lanes_mx[l]);
+        }
+#endif
+        for (; i < count; i++) {
+            mn = fminf(mn, p[i]);
+            mx = fmaxf(mx, p[i]);
+        }
+        lo[k] = mn;
+        hi[k] = mx;
+    }
+}
+
+void VertexArray::normals(const vector<Triangle> &faces, VertexArray &out) const
+{
+    out.resize(0);
+    out.resize(count);
+
+    GLfloat *nx = out.x.data(), *ny = out.y.data(), *nz = out.z.data();
+    const GLfloat *px = x.data(), *py = y.data(), *pz = z.data();
+
+    // The unnormalized cross product already weighs each face by its area
+    for (GLuint f = 0; f < faces.size(); f++) {
+        GLuint a = faces[f].vertex1, b = faces[f].vertex2, c = faces[f].vertex3;
+        GLfloat ux = px[b] - px[a], uy = py[b] - py[a], uz = pz[b] - pz[a];
+        GLfloat vx = px[c] - px[a], vy = py[c] - py[a], vz = pz[c] - pz[a];
+        GLfloat cx = uy * vz - uz * vy;
+        GLfloat cy = uz * vx - ux * vz;
+        GLfloat cz = ux * vy - uy * vx;
+
+        nx[a] += cx; ny[a] += cy; nz[a] += cz;
+        nx[b] += cx; ny[b] += cy; nz[b] += cz;
+        nx[c] += cx; ny[c] += cy; nz[c] += cz;
+    }
+
+    GLuint n = out.padded(), i = 0;
+#ifdef VERTEX_SSE
+    const __m128 tiny = _mm_set1_ps(1e-30f);
+    for (; i < n; i += 4) {
+        __m128 X = _mm_load_ps(nx + i), Y = _mm_load_ps(ny + i), Z = _mm_load_ps(nz + i);
+        __m128 len2 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(X, X), _mm_mul_ps(Y, Y)), _mm_mul_ps(Z, Z));
+        __m128 inv  = _mm_div_ps(_mm_set1_ps(1.0f), _mm_sqrt_ps(_mm_max_ps(len2, tiny)));
+
+        _mm_store_ps(nx + i, _mm_mul_ps(X, inv));
+        _mm_store_ps(ny + i, _mm_mul_ps(Y, inv));
+        _mm_store_ps(nz + i, _mm_mul_ps(Z, inv));
+    }
+#endif
+    for (; i < n; i++) {
+        GLfloat inv = 1.0f / sqrtf(fmaxf(nx[i] * nx[i] + ny[i] * ny[i] + nz[i] * nz[i], 1e-30f));
+        nx[i] *= inv; ny[i] *= inv; nz[i] *= inv;
+    }
+}
+
+void VertexArray::smooth(const vector<Triangle> &faces, GLfloat lambda, GLuint iterations)
+{
+    GLuint n = padded(), f, i;
+
+    // Valence from the face edges; interior edges show up from both faces,
+    // which scales sums and weights alike
+    inv_weight.assign(n, 0.0f);
+    for (f = 0; f < faces.size(); f++) {
+        inv_weight[faces[f].vertex1] += 2.0f;
+        inv_weight[faces[f].vertex2] += 2.0f;
+        inv_weight[faces[f].vertex3] += 2.0f;
+    }
+    keep.assign(n, 0.0f);
+    for (i = 0; i < n; i++) {
+        keep[i] = (inv_weight[i] == 0.0f) ? 1.0f : 0.0f;
+        inv_weight[i] = (inv_weight[i] == 0.0f) ? 0.0f : 1.0f / inv_weight[i];
+    }
+
+    for (GLuint it = 0; it < iterations; it++) {
+        sum_x.assign(n, 0.0f);
+        sum_y.assign(n, 0.0f);
+        sum_z.assign(n, 0.0f);
+
+        for (f = 0; f < faces.size(); f++) {
+            GLuint v[3] = { faces[f].vertex1, faces[f].vertex2, faces[f].vertex3 };
+            for (GLuint e = 0; e < 3; e++) {
+                GLuint a = v[e], b = v[(e + 1) % 3];
+                sum_x[a] += x[b]; sum_y[a] += y[b]; sum_z[a] += z[b];
+                sum_x[b] += x[a]; sum_y[b] += y[a]; sum_z[b] += z[a];
+            }
+        }
+
+        // p += lambda (mean - p), with mean = p where there are no neighbors
+        GLfloat *p[3] = { x.data(), y.data(), z.data() };
+        GLfloat *s[3] = { sum_x.data(), sum_y.data(), sum_z.data() };
+        const GLfloat *w = inv_weight.data(), *k = keep.data();
+
+        for (GLuint c = 0; c < 3; c++) {
+            i = 0;
+#ifdef VERTEX_SSE
+            __m128 L = _mm_set1_ps(lambda);
+            for (; i < n; i += 4) {
+                __m128 P = _mm_load_ps(p[c] + i);
+                __m128 M = _mm_add_ps(_mm_mul_ps(_mm_load_ps(s[c] + i), _mm_load_ps(w + i)),
+                                      _mm_mul_ps(P, _mm_load_ps(k + i)));
+                _mm_store_ps(p[c] + i, _mm_add_ps(P, _mm_mul_ps(L, _mm_sub_ps(M, P))));
+            }
+#endif
+            for (; i < n; i++) {
+                GLfloat mean = s[c][i] * w[i] + p[c][i] * k[i];
+                p[c][i] += lambda * (mean - p[c][i]);
+            }
+        }
+    }
+}
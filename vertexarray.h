@@ -0,0 +1,131 @@
+/**
+ * vertexarray.h
+ * This file contains the VertexArray class, a structure-of-arrays store for
+ * mesh positions. The x, y and z coordinates live in separate arrays that
+ * are aligned and padded to the SIMD width, so the bulk kernels below load
+ * full vectors without shuffling. Adapters convert to and from the
+ * vector<Vector3f> layout used by the rest of the program.
+ */
+
+#ifndef _VERTEXARRAY_H_
+#define _VERTEXARRAY_H_
+
+#ifdef __APPLE__
+#include <OpenGL/gl.h>
+#else
+#include <GL/gl.h>
+#endif
+
+#include <cstddef>
+#include <new>
+#include <vector>
+#include <Eigen/Core>
+#include "mesh.h"
+
+using std::vector;
+using Eigen::Matrix4f;
+using Eigen::Vector3f;
+
+// Channel alignment in bytes and padding in floats (one AVX register)
+const GLuint VERTEX_ALIGN = 32;
+const GLuint VERTEX_PAD   = 8;
+
+/**
+ * AlignedAllocator struct
+ * Allocator for vectors whose storage must start on an Align byte boundary.
+ */
+template <class T, std::size_t Align>
+struct AlignedAllocator {
+    typedef T value_type;
+
+    template <class U>
+    struct rebind { typedef AlignedAllocator<U, Align> other; };
+
+    AlignedAllocator(void) {}
+    template <class U>
+    AlignedAllocator(const AlignedAllocator<U, Align> &) {}
+
+    T *allocate(std::size_t n)
+        { return static_cast<T *>(::operator new(n * sizeof(T), std::align_val_t(Align))); }
+    void deallocate(T *p, std::size_t)
+        { ::operator delete(p, std::align_val_t(Align)); }
+
+    template <class U>
+    bool operator==(const AlignedAllocator<U, Align> &) const { return true; }
+    template <class U>
+    bool operator!=(const AlignedAllocator<U, Align> &) const { return false; }
+};
+
+class VertexArray
+{
+public:
+    typedef vector<GLfloat, AlignedAllocator<GLfloat, VERTEX_ALIGN> > Channel;
+
+    // Coordinates, padded() long; lanes past size() hold zeros
+    Channel x, y, z;
+
+    VertexArray(void) : count(0) {}
+    explicit VertexArray(const vector<Vector3f> &verts) : count(0) { assign(verts); }
+
+    /**
+     * resize
+     * Sets the vertex count, zeroing new vertices and the padding lanes.
+     */
+    void resize(GLuint n);
+
+    void clear(void)
+        { resize(0); }
+
+    GLuint size(void) const
+        { return count; }
+
+    GLuint padded(void) const
+        { return x.size(); }
+
+    Vector3f get(GLuint i) const
+        { return Vector3f(x[i], y[i], z[i]); }
+
+    void set(GLuint i, const Vector3f &v)
+        { x[i] = v.x(); y[i] = v.y(); z[i] = v.z(); }
+
+    /**
+     * assign & copyTo
+     * Convert from and to the array-of-structs layout.
+     */
+    void assign(const vector<Vector3f> &verts);
+    void copyTo(vector<Vector3f> &verts) const;
+
+    /**
+     * transform
+     * Applies the affine part of m (its upper 3x4 block) to every vertex.
+     */
+    void transform(const Matrix4f &m);
+
+    /**
+     * bounds
+     * Axis-aligned bounding box of the vertices. Empty arrays give lo > hi.
+     */
+    void bounds(Vector3f &lo, Vector3f &hi) const;
+
+    /**
+     * normals
+     * Area-weighted unit vertex normals of the triangle mesh, written to out.
+     * Vertices no face touches get a zero normal.
+     */
+    void normals(const vector<Triangle> &faces, VertexArray &out) const;
+
+    /**
+     * smooth
+     * Uniform Laplacian smoothing: every vertex moves lambda of the way to
+     * the mean of its edge neighbors, once per iteration. Vertices without
+     * neighbors stay put.
+     */
+    void smooth(const vector<Triangle> &faces, GLfloat lambda, GLuint iterations);
+
+private:
+    GLuint  count;
+    Channel sum_x, sum_y, sum_z;        // smoothing neighbor sums
+    Channel inv_weight, keep;           // 1/valence, and 1 where valence is 0
+};
+
+#endif